@@ -1,266 +1,556 @@
-#pragma once
-#ifndef EMULATOR_H
-#define EMULATOR_H
-
-/**
- * @file Emulator.h
- * @brief Header file for the emulator project.
- * @details This file contains all the necessary includes, constants, and function declarations required for the emulator.
- * @date 2024-05-28
- * @author Temitope Onafalujo
- */
-
-#define DEBUG //To be fully implemented in Assignment 3 for all debugging print statements in the D0() and E0()
-
-#include "Bitwise_manipulation.h"
-#include "PSW.h"
-#include <stdio.h>
-#include<stdbool.h>
-#include <stdlib.h>
-#include <string.h>
-#include <fcntl.h>
-#include <signal.h> /* Signal handling software */
-
- // Memory sizes
-#define WDMEMSIZE (1 << 15) // 32768 words
-#define BTMEMSIZE (1 << 16) // 65536 bytes
-#define MEM_SIZE 65536
-#define diagnostic_index 500000
-#define diag_buf_len 20
-
-// Buffer and offset sizes
-#define BUFFER_LEN 256
-#define NUM_VALUES 2 // for regfile
-#define NUM_REG_OR_CONS 8 // for regfile
-#define OFFSET 8 // Offset in the record string where the data bytes start
-#define ADDRESS_AND_CHECKSUM_BYTES 3 // Bytes for the address and checksum combined
-#define len_start_pos 2 // Starting position of length in the record (3rd element)
-#define addr_start_pos 4 // Starting position of address in the record (5th element)
-#define PC_INCREMENT 2
-
-// Boolean values
-#define FALSE 0
-#define TRUE 1
-
-// Special constants
-#define INVALID 0xFFFF
-#define NOP 0x4C00 // No-operation instruction (Mov R0, R0)
-
-// ICTRL and DCTRL codes
-#define READ_WORD 0x0 // Read word operation
-#define READ_BYTE 0x1 // Read byte operation
-#define WRITE_WORD 0x2 // Write word operation
-#define WRITE_BYTE 0x3 // Write byte operation
-
-// BYTE_MASK constant
-#define BYTE_MASK 0xFF
-
-/* External variables */
-extern unsigned int cpu_clock;
-extern unsigned short IR;
-extern unsigned short IMAR; //put in fetch_decode.c
-extern unsigned short ICTRL; //put in fetch_decode.c
-extern unsigned short EA; //put in mem_access_inst.c
-extern unsigned short DMAR; //put in mem_access_inst.c
-extern unsigned short DCTRL;// put in mem_access_inst.c
-extern unsigned short regfile[NUM_VALUES][NUM_REG_OR_CONS];
-#define BP regfile[0][4]
-#define LR regfile[0][5]
-#define SP regfile[0][6]
-#define PC regfile[0][7]
-
-// Enums for setting and clearing bits
-enum clr_or_set_bit { clr_bit, set_bit };
-enum INST_OR_DATA_MEM { instruction_mem, data_mem };
-enum READ_OR_WRITE { read, write };
-enum WORD_OR_BYTE { word, byte };
-
-// Union for memory
-union mem {
-    unsigned short wdmem[WDMEMSIZE];
-    unsigned char btmem[BTMEMSIZE];
-};
-
-// Union for word and byte access
-union w_b {
-    unsigned short word;
-    unsigned char byte[2];
-};
-
-/* External variables from other files */
-extern char s_record[BUFFER_LEN];
-extern FILE* s_recfile_descriptor;
-extern int program_running;
-extern unsigned short breakpoint_address;
-extern union mem imemory;
-extern union mem dmemory;
-
-
-
-/* Function declarations for loader.c */
-void loadFile();
-void func_for_s0_record(char* record);
-void func_for_s1_record(char* record);
-void func_for_s2_record(char* record);
-void func_for_s9_record(char* record);
-void displayMemoryRegion(unsigned char* memory);
-
-/* Function declarations for decoder.c */
-void f0();
-void f1();
-void xMC_BUS(unsigned short MAR, unsigned short* MBR, unsigned short CTRL, int isInstruction);
-void D0();
-void display_instruction(unsigned short instruction, const char* name);
-
-/* Function declarations for execute.c */
-void E0();
-void E1();
-
-/* Function declarations for display_change.c */
-void displayPswBits();
-void change_memory_value();
-void displayRegisterFile();
-void change_register_value();
-
-/* Function declarations for psw_code.c */
-extern void update_psw(unsigned short src, unsigned short dst, unsigned short res, unsigned short wb);
-extern void update_psw2(unsigned short result, unsigned short wb);
-
-/* CPU control function */
-void CPU();
-
-/* Function declarations for register instructions execution (ADD - SXT) */
-void execute_ADD();
-void execute_ADDC();
-void execute_SUB();
-void execute_SUBC();
-void execute_DADD();
-unsigned short bcd_add(unsigned short nibble_A, unsigned short nibble_B);
-void execute_CMP();
-void execute_XOR();
-void execute_AND();
-void execute_OR();
-void execute_BIT();
-void execute_BIC();
-void execute_BIS();
-void execute_MOV();
-void execute_SWAP();
-void execute_SRA();
-void execute_RRC();
-void execute_SWPB();
-void execute_SXT();
-
-/* Function declaration for SETCC and CLRCC in setcc_clrcc_execute.c */
-void execute_SETCC();
-void execute_CLRCC();
-
-/* Function declarations for additional instructions execution */
-void execute_MOVL();
-void execute_MOVLZ();
-void execute_MOVLS();
-void execute_MOVH();
-
-/* Function declarations for memory accessing instructions */
-void execute_LD();
-void execute_ST();
-void execute_STR();
-void execute_LDR();
-void ld_effective_addr();
-void st_effective_addr();
-void ldr_effective_addr();
-void str_effective_addr();
-
-/* Function declarations for Branching Instruction */
-void execute_Branching_inst();
-void execute_BL();
-void execute_other_branches();
-
-/* variable that aid branching instruction */
-extern bool d_bubble;
-extern bool e_bubble;
-
-/* Other external variables */
-extern unsigned short last_executed_address;
-extern int skip_update_last_executed_address;
-extern int breakpoint_set;
-
-/* Enum for instruction execution */
-enum instruct_table {
-    BL_EXEC = 0x00, BEQ_BZ_EXEC = 0x01, BNE_BNZ_EXEC = 0x02, BC_BHS_EXEC = 0x03, BNC_BLO_EXEC = 0x04,
-    BN_EXEC = 0x05, BGE_EXEC = 0x06, BLT_EXEC = 0x07, BRA_EXEC = 0x08,
-    ADD_EXEC = 0x09, ADDC_EXEC = 0x0A, SUB_EXEC = 0x0B, SUBC_EXEC = 0x0C, DADD_EXEC = 0x0D,
-    CMP_EXEC = 0x0E, XOR_EXEC = 0x0F, AND_EXEC = 0x10, OR_EXEC = 0x11, BIT_EXEC = 0x12,
-    BIC_EXEC = 0x13, BIS_EXEC = 0x14, MOV_EXEC = 0x15, SWAP_EXEC = 0x16, SRA_EXEC = 0x17,
-    RRC_EXEC = 0x18, SWPB_EXEC = 0x19, SXT_EXEC = 0x1A,
-    SETPRI_EXEC = 0x1B, SVC_EXEC = 0x1C, SETCC_EXEC = 0x1D, CLRCC_EXEC = 0x1E,
-    CEX_EXEC = 0x1F, LD_EXEC = 0x20, ST_EXEC = 0x21, MOVL_EXEC = 0x22,
-    MOVLZ_EXEC = 0x23, MOVLS_EXEC = 0x24, MOVH_EXEC = 0x25, LDR_EXEC = 0x26, STR_EXEC = 0x27
-};
-
-typedef struct {
-
-    unsigned short c;
-    unsigned short z;
-    unsigned short n;
-    unsigned short slp;
-    unsigned short v;
-
-} SETCLRCC;
-
-/* Struct and function for instruction information */
-typedef struct {
-    unsigned char r_c;
-    unsigned char w_b;
-    unsigned char src_con;
-    unsigned char dst;
-    unsigned char data;
-    unsigned char prpo;
-    unsigned char dec;
-    unsigned char inc;
-    unsigned short relative_offset;
-    unsigned short branch_offset;
-    unsigned short instruct_val;
-    SETCLRCC setclr_bits;
-    enum instruct_table instruction_type;
-} InstructionInfo;
-
-extern InstructionInfo global_inst_operands;
-InstructionInfo extract_inst_operands(unsigned short instruction);
-
-
-/* Structs and unions for executing the DADD instruction */
-struct bcd_nibbles {
-    unsigned short nib0 : 4;
-    unsigned short nib1 : 4;
-    unsigned short nib2 : 4;
-    unsigned short nib3 : 4;
-};
-
-union bcd_word_nibble {
-    unsigned short word;
-    struct bcd_nibbles nibble;
-};
-
-
-/* struct for diagnostic display */
-typedef struct {
-    unsigned int clock;
-    unsigned short pc;
-    unsigned short instruction;
-    char fetch[diag_buf_len];
-    char decode[diag_buf_len];
-    char execute[diag_buf_len];
-} DiagnosticInfo;
-// global variables for diagnostic display, defined in main.c
-extern DiagnosticInfo diagnostics[diagnostic_index]; // Adjust size as needed
-extern int diag_index;
-
-/* Globals for control c software */
-extern volatile sig_atomic_t ctrl_c_fnd;
-void sigint_hdlr();
-void init_signal();
-void run_xm();
-
-
-
-#endif // EMULATOR_H
+#pragma once
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+/**
+ * @file Emulator.h
+ * @brief Header file for the emulator project.
+ * @details This file contains all the necessary includes, constants, and function declarations required for the emulator.
+ * @date 2024-05-28
+ * @author Temitope Onafalujo
+ */
+
+#ifndef XM23_RELEASE // Release builds (make release/lto/pgo) leave out the diagnostic trace
+#define DEBUG //To be fully implemented in Assignment 3 for all debugging print statements in the D0() and E0()
+#endif
+
+// Per-core state: each host thread running an XM-23 core (see multicore.c) has its own copy
+#define XM_CORE __thread
+
+#include "Bitwise_manipulation.h"
+#include "PSW.h"
+#include <stdio.h>
+#include<stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <signal.h> /* Signal handling software */
+
+ // Memory sizes
+#define WDMEMSIZE (1 << 15) // 32768 words
+#define BTMEMSIZE (1 << 16) // 65536 bytes
+#define MEM_SIZE 65536
+#define diagnostic_index 500000
+#define diagnostic_ring 64 // Entries for threads that never print the trace; even, like diagnostic_index
+#define diag_buf_len 20
+#define RUN_BATCH 4096 // Half-cycles run between two ^C checks in continuous mode
+
+// Buffer and offset sizes
+#define BUFFER_LEN 256
+#define NUM_VALUES 2 // for regfile
+#define NUM_REG_OR_CONS 8 // for regfile
+#define OFFSET 8 // Offset in the record string where the data bytes start
+#define ADDRESS_AND_CHECKSUM_BYTES 3 // Bytes for the address and checksum combined
+#define len_start_pos 2 // Starting position of length in the record (3rd element)
+#define addr_start_pos 4 // Starting position of address in the record (5th element)
+#define PC_INCREMENT 2
+
+// Boolean values
+#define FALSE 0
+#define TRUE 1
+
+// Special constants
+#define INVALID 0xFFFF
+#define NOP 0x4C00 // No-operation instruction (Mov R0, R0)
+
+// ICTRL and DCTRL codes
+#define READ_WORD 0x0 // Read word operation
+#define READ_BYTE 0x1 // Read byte operation
+#define WRITE_WORD 0x2 // Write word operation
+#define WRITE_BYTE 0x3 // Write byte operation
+
+// BYTE_MASK constant
+#define BYTE_MASK 0xFF
+
+/* External variables */
+extern XM_CORE unsigned int cpu_clock;
+extern XM_CORE unsigned short IR;
+extern XM_CORE unsigned short IMAR; //put in fetch_decode.c
+extern XM_CORE unsigned short ICTRL; //put in fetch_decode.c
+extern XM_CORE unsigned short EA; //put in mem_access_inst.c
+extern XM_CORE unsigned short DMAR; //put in mem_access_inst.c
+extern XM_CORE unsigned short DCTRL;// put in mem_access_inst.c
+extern XM_CORE unsigned short DMBR; // put in mem_access_inst.c
+extern XM_CORE int offset; // LD/ST increment or decrement, put in mem_access_inst.c
+extern unsigned offset_table[2][2][2]; // put in mem_access_inst.c
+extern XM_CORE unsigned short IMBR; // put in fetch_decode.c
+extern XM_CORE unsigned short regfile[NUM_VALUES][NUM_REG_OR_CONS];
+#define BP regfile[0][4]
+#define LR regfile[0][5]
+#define SP regfile[0][6]
+#define PC regfile[0][7]
+
+// Enums for setting and clearing bits
+enum clr_or_set_bit { clr_bit, set_bit };
+enum INST_OR_DATA_MEM { instruction_mem, data_mem };
+enum READ_OR_WRITE { mem_read, mem_write }; // Prefixed to stay clear of the POSIX read()/write() functions
+enum WORD_OR_BYTE { word, byte };
+
+// Union for memory
+union mem {
+    unsigned short wdmem[WDMEMSIZE];
+    unsigned char btmem[BTMEMSIZE];
+};
+
+// Union for word and byte access
+union w_b {
+    unsigned short word;
+    unsigned char byte[2];
+};
+
+/* External variables from other files */
+extern XM_CORE char s_record[BUFFER_LEN];
+extern XM_CORE FILE* s_recfile_descriptor;
+extern XM_CORE int program_running;
+extern XM_CORE unsigned short breakpoint_address;
+extern XM_CORE union mem imemory;
+extern XM_CORE union mem dmemory;
+
+
+
+/* Function declarations for loader.c */
+void loadFile();
+int load_xme_file(const char* filename);
+int load_xme_buffer(const char* records, size_t length);
+void process_s_records();
+void func_for_s0_record(char* record);
+void func_for_s1_record(char* record);
+void func_for_s2_record(char* record);
+void func_for_s9_record(char* record);
+void displayMemoryRegion(unsigned char* memory);
+
+/* Function declarations for decoder.c */
+void f0();
+void f1();
+void xMC_BUS(unsigned short MAR, unsigned short* MBR, unsigned short CTRL, int isInstruction);
+void D0();
+void display_instruction(unsigned short instruction, const char* name);
+
+/* Function declarations for execute.c */
+void E0();
+void E1();
+
+/* Function declarations for display_change.c */
+void displayPswBits();
+void change_memory_value();
+void displayRegisterFile();
+void change_register_value();
+
+/* Function declarations for psw_code.c */
+extern void update_psw(unsigned short src, unsigned short dst, unsigned short res, unsigned short wb);
+extern void update_psw2(unsigned short result, unsigned short wb);
+
+/* CPU control function */
+void CPU();
+void cpu_sleep();
+int idle_skip();
+extern XM_CORE int mem_exec_stage; // E1 of a LD/ST/LDR/STR is due on the next even tick
+
+/* Device event scheduler, defined in scheduler.c */
+#define SCHED_MAX_EVENTS 64 // Events pending at once
+
+typedef void (*sched_fn)(void* context, unsigned int when);
+
+extern XM_CORE int sched_pending;
+int sched_post(unsigned int when, sched_fn fn, void* context);
+int sched_post_in(unsigned int cycles, sched_fn fn, void* context);
+int sched_cancel(int id);
+unsigned int sched_cycles_until_next(unsigned int limit);
+int sched_next_event(unsigned int* when);
+void sched_dispatch();
+void sched_clear();
+
+/* Fused execution loop, defined in cpu_fused.c */
+void cpu_fused_init();
+int idle_skip_allowed();
+int cpu_fused_allowed();
+void CPU_fused(unsigned int slots);
+
+/* Function declarations for register instructions execution (ADD - SXT) */
+void execute_ADD();
+void execute_ADDC();
+void execute_SUB();
+void execute_SUBC();
+void execute_DADD();
+unsigned short bcd_add(unsigned short nibble_A, unsigned short nibble_B);
+unsigned short bcd_add_swar(unsigned short src, unsigned short dst, unsigned short wb, unsigned short* carry);
+void execute_CMP();
+void execute_XOR();
+void execute_AND();
+void execute_OR();
+void execute_BIT();
+void execute_BIC();
+void execute_BIS();
+void execute_MOV();
+void execute_SWAP();
+void execute_SRA();
+void execute_RRC();
+void execute_SWPB();
+void execute_SXT();
+
+/* Function declaration for SETCC and CLRCC in setcc_clrcc_execute.c */
+void execute_SETCC();
+void execute_CLRCC();
+
+/* Function declarations for additional instructions execution */
+void execute_MOVL();
+void execute_MOVLZ();
+void execute_MOVLS();
+void execute_MOVH();
+
+/* Function declarations for memory accessing instructions */
+void execute_LD();
+void execute_ST();
+void execute_STR();
+void execute_LDR();
+void ld_effective_addr();
+void st_effective_addr();
+void ldr_effective_addr();
+void str_effective_addr();
+
+/* Function declarations for Branching Instruction */
+void execute_Branching_inst();
+void execute_BL();
+void execute_other_branches();
+
+/* Conditional execution, defined in cex_execute.c */
+extern XM_CORE unsigned short cex_mask;
+extern XM_CORE unsigned short cex_count;
+extern XM_CORE int cex_skipped;
+unsigned short cex_conditions(unsigned short c, unsigned short z, unsigned short n, unsigned short v);
+void execute_CEX();
+
+/* variable that aid branching instruction */
+extern XM_CORE bool d_bubble;
+extern XM_CORE bool e_bubble;
+
+/* Other external variables */
+extern XM_CORE unsigned short last_executed_address;
+extern XM_CORE int skip_update_last_executed_address;
+extern XM_CORE int breakpoint_set;
+
+/* Enum for instruction execution */
+enum instruct_table {
+    BL_EXEC = 0x00, BEQ_BZ_EXEC = 0x01, BNE_BNZ_EXEC = 0x02, BC_BHS_EXEC = 0x03, BNC_BLO_EXEC = 0x04,
+    BN_EXEC = 0x05, BGE_EXEC = 0x06, BLT_EXEC = 0x07, BRA_EXEC = 0x08,
+    ADD_EXEC = 0x09, ADDC_EXEC = 0x0A, SUB_EXEC = 0x0B, SUBC_EXEC = 0x0C, DADD_EXEC = 0x0D,
+    CMP_EXEC = 0x0E, XOR_EXEC = 0x0F, AND_EXEC = 0x10, OR_EXEC = 0x11, BIT_EXEC = 0x12,
+    BIC_EXEC = 0x13, BIS_EXEC = 0x14, MOV_EXEC = 0x15, SWAP_EXEC = 0x16, SRA_EXEC = 0x17,
+    RRC_EXEC = 0x18, SWPB_EXEC = 0x19, SXT_EXEC = 0x1A,
+    SETPRI_EXEC = 0x1B, SVC_EXEC = 0x1C, SETCC_EXEC = 0x1D, CLRCC_EXEC = 0x1E,
+    CEX_EXEC = 0x1F, LD_EXEC = 0x20, ST_EXEC = 0x21, MOVL_EXEC = 0x22,
+    MOVLZ_EXEC = 0x23, MOVLS_EXEC = 0x24, MOVH_EXEC = 0x25, LDR_EXEC = 0x26, STR_EXEC = 0x27
+};
+
+typedef struct {
+
+    unsigned short c;
+    unsigned short z;
+    unsigned short n;
+    unsigned short slp;
+    unsigned short v;
+
+} SETCLRCC;
+
+/* Struct and function for instruction information */
+typedef struct {
+    unsigned char r_c;
+    unsigned char w_b;
+    unsigned char src_con;
+    unsigned char dst;
+    unsigned char data;
+    unsigned char prpo;
+    unsigned char dec;
+    unsigned char inc;
+    unsigned short relative_offset;
+    unsigned short branch_offset;
+    unsigned short instruct_val;
+    SETCLRCC setclr_bits;
+    enum instruct_table instruction_type;
+} InstructionInfo;
+
+extern XM_CORE InstructionInfo global_inst_operands;
+InstructionInfo extract_inst_operands(unsigned short instruction);
+
+
+/* Trace filters, defined in trace_filter.c */
+#define TRACE_FILTER_PC     0x01 // Only instructions inside the selected PC ranges
+#define TRACE_FILTER_TYPE   0x02 // Only the selected instruction classes
+#define TRACE_FILTER_TAKEN  0x04 // Only taken branches
+#define TRACE_FILTER_REG    0x08 // Only when a register is written with a given value
+#define TRACE_FILTER_SAMPLE 0x10 // Only every Nth instruction
+
+#define TRACE_PC_MAP_LEN (MEM_SIZE >> 4) // One bit per word address
+#define TRACE_PC_TEST(addr) (trace_pc_map[(addr) >> 4] & (1 << (((addr) >> 1) & 0x07)))
+
+#define TRACE_TYPE_BIT(type) (1ULL << (type))
+#define TRACE_TYPE_RANGE(first, last) (((1ULL << ((last) - (first) + 1)) - 1) << (first))
+#define TRACE_CLASS_BRANCH TRACE_TYPE_RANGE(BL_EXEC, BRA_EXEC)
+#define TRACE_CLASS_ALU    TRACE_TYPE_RANGE(ADD_EXEC, SXT_EXEC)
+#define TRACE_CLASS_CC     TRACE_TYPE_RANGE(SETCC_EXEC, CLRCC_EXEC)
+#define TRACE_CLASS_MOVL   TRACE_TYPE_RANGE(MOVL_EXEC, MOVH_EXEC)
+#define TRACE_CLASS_MEMORY (TRACE_TYPE_BIT(LD_EXEC) | TRACE_TYPE_BIT(ST_EXEC) | TRACE_TYPE_BIT(LDR_EXEC) | TRACE_TYPE_BIT(STR_EXEC))
+
+extern int trace_enabled;
+extern int trace_disasm;
+extern unsigned int trace_filter_flags;
+extern unsigned char trace_pc_map[TRACE_PC_MAP_LEN];
+extern unsigned long long trace_type_mask;
+
+int trace_filter_pass(int e1_dst);
+void trace_add_pc_range(unsigned short start, unsigned short end);
+void trace_clear_filters();
+void trace_filter_menu();
+
+
+/* Disassembler, defined in disassembler.c */
+#define DISASM_TEXT_LEN 20 // Longest cached mnemonic with operands
+#define DISASM_BUF_LEN 32  // Caller buffer, large enough for a mnemonic and its branch target
+
+const char* disassemble(unsigned short instruction, unsigned short address, char* buf);
+void displayDisassembly();
+
+
+/* Sampling profiler, defined in sample_profiler.c */
+#define PROF_MAX_SAMPLES (1 << 20) // Samples kept before new ones are dropped
+#define PROF_STACK_DEPTH 8         // Frames recorded per sample, including the executing address
+#define PROF_STACK_SCAN 32         // Stack words searched for saved return addresses
+#define PROF_DEFAULT_RATE 1000     // Samples per second
+
+extern int profiler_active;
+int profiler_start(unsigned int rate, const char* filename);
+void profiler_stop();
+void profiler_resume();
+void profiler_pause();
+void profiler_menu();
+
+
+/* Machine state snapshots, defined in snapshot.c */
+#define SNAPSHOT_MAGIC "XM23SNAP"
+#define SNAPSHOT_VERSION 2
+#define DIRTY_PAGE_SHIFT 8 // Dirty pages of 256 bytes
+#define DIRTY_PAGE_SIZE (1 << DIRTY_PAGE_SHIFT)
+#define DIRTY_PAGE_COUNT (BTMEMSIZE >> DIRTY_PAGE_SHIFT)
+#define DIRTY_WORDS (DIRTY_PAGE_COUNT / 32) // 32 page bits per word
+
+typedef struct {
+    union mem imem;
+    union mem dmem;
+    unsigned short regs[NUM_REG_OR_CONS];
+    struct psw_bits psw;
+    unsigned int clock;
+    // Pipeline registers, so a restored state carries on from the same half-cycle
+    unsigned short imar, ir, imbr, ictrl, ea, dmar, dmbr, dctrl;
+    int mem_offset, mem_exec_stage, d_bubble, e_bubble;
+    unsigned short last_executed_address;
+    int skip_update;
+    unsigned short cex_mask, cex_count;
+    InstructionInfo operands;
+    unsigned int dirty[2][DIRTY_WORDS]; // Pages that may differ from the reset image, not saved to files
+} MachineState;
+
+void state_capture(MachineState* state);
+void state_restore(const MachineState* state);
+void state_capture_registers(MachineState* state);
+void state_restore_registers(const MachineState* state);
+int state_save(const MachineState* state, const char* filename);
+int state_load(MachineState* state, const char* filename);
+
+
+/* Dirty-page tracking and reset images, defined in dirty_pages.c */
+#define DIRTY_SET(bits, address) ((bits)[(address) >> (DIRTY_PAGE_SHIFT + 5)] |= 1u << (((address) >> DIRTY_PAGE_SHIFT) & 31))
+#define MARK_DIRTY(memory, address) DIRTY_SET(dirty_pages[memory], address)
+
+extern XM_CORE unsigned int dirty_pages[2][DIRTY_WORDS];
+extern XM_CORE MachineState* reset_image;
+void dirty_mark_range(int memory, unsigned int address, unsigned int length);
+unsigned int dirty_count(int memory);
+void reset_image_update();
+int reset_to_image();
+int checkpoint_capture(MachineState* checkpoint);
+int checkpoint_restore(const MachineState* checkpoint);
+
+/* Machine state comparison and lockstep checking, defined in state_diff.c */
+#define DIFF_MAX_RUNS 4096 // Changed runs reported per memory
+
+typedef struct {
+    unsigned int start;
+    unsigned int length;
+} DiffRun;
+
+int diff_memory(const unsigned char* before, const unsigned char* after, unsigned int length, DiffRun* runs, int max_runs);
+int state_diff(const MachineState* before, const MachineState* after);
+int state_equal(const MachineState* a, const MachineState* b);
+int lockstep_run(unsigned int interval);
+void state_diff_menu();
+
+/* Memory search, defined in mem_search.c */
+#define SEARCH_MAX_PATTERN 16 // Longest byte sequence
+
+typedef struct {
+    unsigned char value[SEARCH_MAX_PATTERN]; // Already masked
+    unsigned char mask[SEARCH_MAX_PATTERN];  // Bits that must match, 0 for a wildcard
+    unsigned int length;
+    int aligned;      // Only even addresses
+    int changed_only; // Only addresses whose bytes changed since the last search
+} SearchPattern;
+
+int mem_search(const unsigned char* mem, const SearchPattern* pattern, const unsigned char* previous,
+               unsigned short* hits, int max_hits);
+int search_parse(const char* spec, SearchPattern* pattern, enum INST_OR_DATA_MEM* memory);
+void search_record(enum INST_OR_DATA_MEM memory);
+int search_command(const char* spec);
+void mem_search_menu();
+
+/* Multi-core runs, defined in multicore.c */
+#define MC_MAX_CORES 16
+#define MC_DEFAULT_QUANTUM 10000 // Clock cycles between two exchanges of shared data memory
+
+int multicore_add_image(const char* filename);
+int multicore_run(int cores, unsigned int quantum, unsigned int cycle_limit);
+
+/* Call-graph profiler, defined in callgraph.c */
+#define CALLGRAPH_MAX_NODES (1 << 16) // Distinct call paths
+#define CALLGRAPH_MAX_DEPTH 1024      // Shadow call stack frames
+#define CALLGRAPH_MAX_CHILDREN 64     // Callees listed under one node of the call tree
+#define CALLGRAPH_MAX_SYMBOLS 4096
+#define CALLGRAPH_NAME_LEN 64
+
+extern int callgraph_enabled;
+int callgraph_symbols(const char* filename);
+int callgraph_start(const char* prefix);
+int callgraph_stop();
+void callgraph_step(unsigned short address);
+void callgraph_call(unsigned short return_address, unsigned short target);
+void callgraph_memory_access();
+void callgraph_menu();
+
+/* Data memory heatmap, defined in mem_heatmap.c */
+#define HEATMAP_LINE_SHIFT 4 // Lines of 16 bytes
+#define HEATMAP_LINE_BYTES (1 << HEATMAP_LINE_SHIFT)
+#define HEATMAP_LINES (BTMEMSIZE >> HEATMAP_LINE_SHIFT)
+#define HEATMAP_MAX_WINDOWS 4096 // Bandwidth windows kept before neighbours are merged
+#define HEATMAP_DEFAULT_WINDOW 10000
+#define HEATMAP_SUMMARY_LINES 8  // Hottest lines listed after a -H run
+#define HEATMAP_BYTE ((1ull << 32) | 1) // One access of one byte
+#define HEATMAP_WORD ((1ull << 32) | 2)
+// One E1 access of a byte (wb set) or word at address, on clock
+#define HEATMAP_COUNT(lines, address, wb, clock)                    \
+    do {                                                            \
+        if ((int)((clock) - heatmap_window_end) >= 0) {             \
+            heatmap_window_close(clock);                            \
+        }                                                           \
+        (lines)[(address) >> HEATMAP_LINE_SHIFT] += (wb) ? HEATMAP_BYTE : HEATMAP_WORD; \
+    } while (0)
+
+extern int heatmap_enabled;
+extern unsigned long long heatmap_reads[HEATMAP_LINES];
+extern unsigned long long heatmap_writes[HEATMAP_LINES];
+extern unsigned int heatmap_window_end;
+void heatmap_window_close(unsigned int clock);
+void heatmap_reset(unsigned int window_cycles);
+int heatmap_export(const char* filename);
+void heatmap_top(int count);
+void heatmap_menu();
+
+/* Guest code coverage, defined in coverage.c */
+#define COV_EDGE_MAP_SIZE (1 << 16) // AFL-style edge map, one saturating byte per bucket
+
+extern int coverage_enabled;
+extern XM_CORE unsigned int coverage_hits[WDMEMSIZE]; // Counted inline by E0() and CPU_fused()
+void coverage_branch(unsigned short from, unsigned short to, int taken);
+void coverage_loop(unsigned short first, unsigned short branch, unsigned int count);
+void coverage_reset();
+void coverage_cores_start();
+void coverage_core_finish();
+int coverage_load(const char* filename);
+int coverage_save(const char* filename);
+int coverage_report(const char* filename, const char* source);
+
+/* Timing model, defined in timing.c */
+#define TIMING_TYPES (STR_EXEC + 1) // One latency per enum instruct_table value
+#define TIMING_MAX_CYCLES 127       // Largest stall of one setting, kept in a byte as ticks
+
+typedef struct {
+    unsigned char fetch[WDMEMSIZE];   // Clock ticks added to a fetch of each instruction word
+    unsigned char data[WDMEMSIZE];    // Clock ticks added to an E1 access of each data word
+    unsigned char latency[TIMING_TYPES];
+    unsigned char branch_taken;
+    unsigned char branch_not_taken;
+} TimingConfig;
+
+typedef struct {
+    unsigned int instructions; // Executed by E0, bubbles excluded
+    unsigned int fetch;        // Stall cycles by cause
+    unsigned int data;
+    unsigned int execute;
+    unsigned int branch;
+} TimingCounters;
+
+extern XM_CORE int timing_active; // Clear for the default one cycle per instruction
+extern XM_CORE TimingConfig timing;
+extern XM_CORE TimingCounters timing_counts;
+unsigned int timing_fetch(unsigned short address);
+unsigned int timing_data(unsigned short address);
+unsigned int timing_execute();
+int timing_setting(TimingConfig* config, char* line);
+int timing_parse(TimingConfig* config, const char* filename);
+void timing_set(const TimingConfig* config);
+int timing_load(const char* filename);
+void timing_report();
+void timing_menu();
+
+/* Parallel timing sweeps, defined in sweep.c */
+#define SWEEP_MAX_AXES 8
+#define SWEEP_MAX_VALUES 32 // Values of one axis
+#define SWEEP_MAX_POINTS 4096
+#define SWEEP_MAX_THREADS 64
+
+int sweep_run(const char* filename, int threads, unsigned int cycle_limit);
+
+/* GDB remote serial protocol server, defined in gdb_stub.c */
+#define GDB_MAX_BREAKPOINTS 64
+#define GDB_MAX_WATCHPOINTS 16
+
+int gdb_serve(const char* address);
+
+
+/* Structs and unions for executing the DADD instruction */
+struct bcd_nibbles {
+    unsigned short nib0 : 4;
+    unsigned short nib1 : 4;
+    unsigned short nib2 : 4;
+    unsigned short nib3 : 4;
+};
+
+union bcd_word_nibble {
+    unsigned short word;
+    struct bcd_nibbles nibble;
+};
+
+
+/* struct for diagnostic display */
+typedef struct {
+    unsigned int clock;
+    unsigned short pc;
+    unsigned short instruction;
+    char fetch[diag_buf_len];
+    char decode[diag_buf_len];
+    char execute[diag_buf_len];
+} DiagnosticInfo;
+// global variables for diagnostic display, defined in cpu.c
+extern XM_CORE DiagnosticInfo* diagnostics; // diagnostic_size entries
+extern XM_CORE int diagnostic_size;
+extern XM_CORE int diag_index;
+
+/* Globals for control c software */
+extern volatile sig_atomic_t ctrl_c_fnd;
+void sigint_hdlr(int signum);
+void init_signal();
+void run_xm();
+int run_xm_continuous();
+
+
+
+#endif // EMULATOR_H
@@ -0,0 +1,466 @@
+/**
+ * @file alu_sweep.c
+ * @brief Exhaustive conformance sweep of the ALU handlers against a reference model.
+ * @details Every two-operand ALU instruction is run in both widths over all 2^32 source and
+ *          destination pairs, with carry in 0 and 1 where the instruction reads it, and the
+ *          destination, source and C/Z/N/V bits are compared with the reference model below.
+ *          Single-operand instructions cover all 2^16 destinations. The model is written
+ *          independently of the handlers: results come from the full-width sum, flags are
+ *          defined from the arithmetic rather than from the operand sign bits, and each batch
+ *          of 256 destinations is a plain loop the compiler vectorizes.
+ *          The handlers work on the emulator globals, so the source words are split across
+ *          forked worker processes (one per online CPU) rather than threads. Workers stop
+ *          checking an instruction after its first mismatches and send them to the parent.
+ *          Usage: alu_sweep [-j workers] [-n mismatches] [-s source step] [-o ADD,XOR.B,...]
+ */
+
+#include "../Emulator.h"
+#include <strings.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define BATCH 256              // Destinations per reference batch
+#define DEFAULT_REPORTED 4     // Mismatches reported per instruction and width
+#define MAX_WORKERS 256
+
+/* Reference flags, packed */
+#define FLAG_C 0x01
+#define FLAG_Z 0x02
+#define FLAG_N 0x04
+#define FLAG_V 0x08
+
+typedef void (*handler_fn)();
+
+typedef struct {
+    const char* name;
+    enum instruct_table type;
+    handler_fn fn;
+    int has_src;     // Reads a source register or constant
+    int has_byte;    // Has a .B form
+    int reads_carry; // Result depends on the carry in, so both carries are swept
+} SweepOp;
+
+static const SweepOp sweep_ops[] = {
+    { "ADD", ADD_EXEC, execute_ADD, TRUE, TRUE, FALSE },
+    { "ADDC", ADDC_EXEC, execute_ADDC, TRUE, TRUE, TRUE },
+    { "SUB", SUB_EXEC, execute_SUB, TRUE, TRUE, FALSE },
+    { "SUBC", SUBC_EXEC, execute_SUBC, TRUE, TRUE, TRUE },
+    { "DADD", DADD_EXEC, execute_DADD, TRUE, TRUE, TRUE },
+    { "CMP", CMP_EXEC, execute_CMP, TRUE, TRUE, FALSE },
+    { "XOR", XOR_EXEC, execute_XOR, TRUE, TRUE, FALSE },
+    { "AND", AND_EXEC, execute_AND, TRUE, TRUE, FALSE },
+    { "OR", OR_EXEC, execute_OR, TRUE, TRUE, FALSE },
+    { "BIT", BIT_EXEC, execute_BIT, TRUE, TRUE, FALSE },
+    { "BIC", BIC_EXEC, execute_BIC, TRUE, TRUE, FALSE },
+    { "BIS", BIS_EXEC, execute_BIS, TRUE, TRUE, FALSE },
+    { "MOV", MOV_EXEC, execute_MOV, TRUE, TRUE, FALSE },
+    { "SWAP", SWAP_EXEC, execute_SWAP, TRUE, FALSE, FALSE },
+    { "SRA", SRA_EXEC, execute_SRA, FALSE, TRUE, FALSE },
+    { "RRC", RRC_EXEC, execute_RRC, FALSE, TRUE, TRUE },
+    { "SWPB", SWPB_EXEC, execute_SWPB, FALSE, FALSE, FALSE },
+    { "SXT", SXT_EXEC, execute_SXT, FALSE, FALSE, FALSE }
+};
+
+#define NUM_OPS ((int)(sizeof(sweep_ops) / sizeof(sweep_ops[0])))
+
+/* One mismatch, or (with op < 0) the end of a worker's results */
+typedef struct {
+    int op, wb;
+    unsigned short src, dst, flags_in;
+    unsigned short expected_dst, expected_src, expected_flags;
+    unsigned short got_dst, got_src, got_flags;
+    unsigned long long checked;
+} Mismatch;
+
+static unsigned int max_reported = DEFAULT_REPORTED;
+static unsigned int src_step = 1;
+static int selected[NUM_OPS][2];
+
+/**
+ * @brief Reference results for one instruction, width, source and carry over BATCH destinations.
+ * @details The flags of instructions that leave a bit alone are passed through from flags_in.
+ */
+static void reference_batch(enum instruct_table type, unsigned int wb, unsigned int src, unsigned int base,
+                            unsigned int flags_in, unsigned short* res, unsigned short* src_out, unsigned short* flags) {
+    const unsigned int mask = wb ? 0xFF : 0xFFFF;
+    const unsigned int width = wb ? 8 : 16;
+    const unsigned int msb = width - 1;
+    const unsigned int cin = flags_in & FLAG_C;
+    const unsigned int keep = flags_in & (FLAG_C | FLAG_V); // Logic instructions leave C and V alone
+    unsigned int s = src & mask, i;
+
+    for (i = 0; i < BATCH; i++) {
+        src_out[i] = (unsigned short)src;
+    }
+
+    switch (type) {
+    case ADD_EXEC:
+    case ADDC_EXEC:
+    case SUB_EXEC:
+    case SUBC_EXEC:
+    case CMP_EXEC: {
+        // Subtraction adds the one's complement of the source plus 1 (or the carry)
+        unsigned int operand = (type == ADD_EXEC || type == ADDC_EXEC) ? s : (~s & mask);
+        unsigned int carry = (type == ADDC_EXEC || type == SUBC_EXEC) ? cin : (type == ADD_EXEC ? 0 : 1);
+
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & mask;
+            unsigned int sum = d + operand + carry;
+            unsigned int r = sum & mask;
+            unsigned int v = ((~(d ^ operand) & (d ^ r)) >> msb) & 1;
+
+            res[i] = (unsigned short)(type == CMP_EXEC ? base + i : r);
+            flags[i] = (unsigned short)((sum >> width) | (r == 0) << 1 | (r >> msb) << 2 | v << 3);
+        }
+        break;
+    }
+    case DADD_EXEC:
+        // Digit by digit; C is the decimal carry out, V is cleared
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = base + i, r = wb ? d & 0xFF00 : 0, carry = cin, digit, t;
+
+            for (digit = 0; digit < width; digit += 4) {
+                t = ((s >> digit) & 0x0F) + ((d >> digit) & 0x0F) + carry;
+                carry = t >= 10;
+                r |= ((t - 10 * carry) & 0x0F) << digit;
+            }
+            res[i] = (unsigned short)r;
+            flags[i] = (unsigned short)(carry | ((r & mask) == 0) << 1 | ((r >> msb) & 1) << 2);
+        }
+        break;
+    case XOR_EXEC:
+    case AND_EXEC:
+    case OR_EXEC:
+    case BIC_EXEC:
+    case BIS_EXEC: {
+        // BIC and BIS take a bit number; one past the width selects no bit
+        unsigned int bit = s < width ? 1u << s : 0;
+
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & mask;
+            unsigned int r = type == XOR_EXEC ? d ^ s : type == AND_EXEC ? d & s : type == OR_EXEC ? d | s :
+                             type == BIC_EXEC ? d & ~bit & mask : d | bit;
+
+            res[i] = (unsigned short)r;
+            flags[i] = (unsigned short)(keep | (r == 0) << 1 | (r >> msb) << 2);
+        }
+        break;
+    }
+    case BIT_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & mask;
+            unsigned int set = s < width ? (d >> s) & 1 : 0;
+
+            res[i] = (unsigned short)(base + i);
+            flags[i] = (unsigned short)((flags_in & ~FLAG_Z) | !set << 1);
+        }
+        break;
+    case MOV_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            res[i] = (unsigned short)s;
+            flags[i] = (unsigned short)flags_in;
+        }
+        break;
+    case SWAP_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            res[i] = (unsigned short)src;
+            src_out[i] = (unsigned short)(base + i);
+            flags[i] = (unsigned short)flags_in;
+        }
+        break;
+    case SRA_EXEC:
+        // Arithmetic: the sign bit is kept
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & mask;
+
+            res[i] = (unsigned short)((d >> 1) | (d & (1u << msb)));
+            flags[i] = (unsigned short)flags_in;
+        }
+        break;
+    case RRC_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & mask;
+
+            res[i] = (unsigned short)((d >> 1) | cin << msb);
+            flags[i] = (unsigned short)((flags_in & ~FLAG_C) | (d & 1));
+        }
+        break;
+    case SWPB_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = base + i;
+
+            res[i] = (unsigned short)((d << 8 | d >> 8) & 0xFFFF);
+            flags[i] = (unsigned short)flags_in;
+        }
+        break;
+    case SXT_EXEC:
+        for (i = 0; i < BATCH; i++) {
+            unsigned int d = (base + i) & 0xFF;
+
+            res[i] = (unsigned short)(d | (0u - (d >> 7)) << 8);
+            flags[i] = (unsigned short)flags_in;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Run the emulator handler on R0 (destination) and R1 (source).
+ */
+static void run_handler(const SweepOp* op, unsigned int wb, unsigned short src, unsigned short dst,
+                        unsigned int flags_in, unsigned short* got_dst, unsigned short* got_src, unsigned short* got_flags) {
+    regfile[0][0] = dst;
+    regfile[0][1] = src;
+    psw.c = flags_in & FLAG_C ? 1 : 0;
+    psw.z = flags_in & FLAG_Z ? 1 : 0;
+    psw.n = flags_in & FLAG_N ? 1 : 0;
+    psw.v = flags_in & FLAG_V ? 1 : 0;
+
+    op->fn();
+
+    *got_dst = regfile[0][0];
+    *got_src = regfile[0][1];
+    *got_flags = (unsigned short)(psw.c | psw.z << 1 | psw.n << 2 | psw.v << 3);
+}
+
+/**
+ * @brief Sweep the source words worker, worker + workers, ... and write the mismatches to out.
+ */
+static void sweep_worker(int worker, int workers, int out) {
+    static unsigned short res[BATCH], src_out[BATCH], flags[BATCH];
+    unsigned int reported[NUM_OPS][2];
+    unsigned long long checked = 0;
+    unsigned int src, base, i, carry, flags_in, wb;
+    unsigned short got_dst, got_src, got_flags;
+    Mismatch m;
+    int op;
+
+    memset(reported, 0, sizeof(reported));
+    memset(&global_inst_operands, 0, sizeof(global_inst_operands));
+    global_inst_operands.dst = 0;
+    global_inst_operands.src_con = 1;
+    global_inst_operands.r_c = 0;
+
+    for (op = 0; op < NUM_OPS; op++) {
+        const SweepOp* sweep = &sweep_ops[op];
+
+        global_inst_operands.instruction_type = sweep->type;
+        for (wb = 0; wb <= (sweep->has_byte ? 1u : 0u); wb++) {
+            if (!selected[op][wb]) {
+                continue;
+            }
+            global_inst_operands.w_b = (unsigned short)wb;
+            for (src = (unsigned int)worker * src_step; src <= (sweep->has_src ? 0xFFFFu : 0u);
+                 src += (unsigned int)workers * src_step) {
+                for (carry = 0; carry <= (sweep->reads_carry ? 1u : 0u); carry++) {
+                    for (base = 0; base <= 0xFFFF && reported[op][wb] < max_reported; base += BATCH) {
+                        // Z, N and V start from a pattern that changes between batches, as does C
+                        // for instructions that do not read it
+                        flags_in = ((src ^ (base >> 8)) & (FLAG_Z | FLAG_N | FLAG_V)) |
+                                   (sweep->reads_carry ? carry : (base >> 8) & FLAG_C);
+                        reference_batch(sweep->type, wb, src, base, flags_in, res, src_out, flags);
+                        for (i = 0; i < BATCH; i++) {
+                            run_handler(sweep, wb, (unsigned short)src, (unsigned short)(base + i), flags_in,
+                                &got_dst, &got_src, &got_flags);
+                            if (got_dst != res[i] || got_src != src_out[i] || got_flags != flags[i]) {
+                                if (reported[op][wb]++ < max_reported) {
+                                    memset(&m, 0, sizeof(m));
+                                    m.op = op;
+                                    m.wb = (int)wb;
+                                    m.src = (unsigned short)src;
+                                    m.dst = (unsigned short)(base + i);
+                                    m.flags_in = (unsigned short)flags_in;
+                                    m.expected_dst = res[i];
+                                    m.expected_src = src_out[i];
+                                    m.expected_flags = flags[i];
+                                    m.got_dst = got_dst;
+                                    m.got_src = got_src;
+                                    m.got_flags = got_flags;
+                                    if (write(out, &m, sizeof(m)) != sizeof(m)) {
+                                        _exit(1);
+                                    }
+                                }
+                            }
+                        }
+                        checked += BATCH;
+                    }
+                }
+            }
+        }
+    }
+
+    memset(&m, 0, sizeof(m));
+    m.op = -1;
+    m.checked = checked;
+    if (write(out, &m, sizeof(m)) != sizeof(m)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * @brief Order mismatches by instruction, width, source and destination.
+ */
+static int compare_mismatch(const void* a, const void* b) {
+    const Mismatch* x = a;
+    const Mismatch* y = b;
+
+    if (x->op != y->op) return x->op - y->op;
+    if (x->wb != y->wb) return x->wb - y->wb;
+    if (x->src != y->src) return x->src - y->src;
+    if (x->dst != y->dst) return x->dst - y->dst;
+    return x->flags_in - y->flags_in;
+}
+
+/**
+ * @brief Print flags as CZNV letters, '-' for a clear bit.
+ */
+static const char* flag_text(unsigned short flags, char* text) {
+    text[0] = flags & FLAG_C ? 'C' : '-';
+    text[1] = flags & FLAG_Z ? 'Z' : '-';
+    text[2] = flags & FLAG_N ? 'N' : '-';
+    text[3] = flags & FLAG_V ? 'V' : '-';
+    text[4] = '\0';
+    return text;
+}
+
+/**
+ * @brief Select the instructions named in a list such as "ADD,XOR.B" (no width means both).
+ * @return FALSE if a name is unknown.
+ */
+static int select_ops(char* list) {
+    char* name;
+    char* suffix;
+    int op, found;
+
+    memset(selected, 0, sizeof(selected));
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        suffix = strchr(name, '.');
+        if (suffix != NULL) {
+            *suffix++ = '\0';
+        }
+        found = FALSE;
+        for (op = 0; op < NUM_OPS; op++) {
+            if (strcasecmp(name, sweep_ops[op].name) == 0) {
+                selected[op][0] |= suffix == NULL || toupper((unsigned char)*suffix) == 'W';
+                selected[op][1] |= sweep_ops[op].has_byte && (suffix == NULL || toupper((unsigned char)*suffix) == 'B');
+                found = TRUE;
+            }
+        }
+        if (!found) {
+            printf("Unknown instruction >%s<\n", name);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+int main(int argc, char* argv[]) {
+    static Mismatch found[MAX_WORKERS * NUM_OPS * 2 * 8];
+    int pipes[MAX_WORKERS];
+    pid_t pids[MAX_WORKERS];
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long checked = 0;
+    int count = 0, done, opt, w, n, op, wb, shown, failing = 0;
+    char expected_text[5], got_text[5], in_text[5];
+    Mismatch m;
+
+    for (op = 0; op < NUM_OPS; op++) {
+        selected[op][0] = TRUE;
+        selected[op][1] = sweep_ops[op].has_byte;
+    }
+
+    while ((opt = getopt(argc, argv, "j:n:s:o:")) != -1) {
+        switch (opt) {
+        case 'j':
+            workers = strtol(optarg, NULL, 0);
+            break;
+        case 'n':
+            max_reported = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            src_step = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            if (!select_ops(optarg)) {
+                return 1;
+            }
+            break;
+        default:
+            printf("Usage: %s [-j workers] [-n mismatches] [-s source step] [-o ADD,XOR.B,...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+    if (max_reported < 1) max_reported = 1;
+    if (max_reported > 8) max_reported = 8;
+    if (src_step < 1) src_step = 1;
+
+    printf("Sweeping the ALU with %ld worker(s)%s\n", workers, src_step > 1 ? ", sampled sources" : "");
+    fflush(stdout);
+    for (w = 0; w < workers; w++) {
+        int fds[2];
+
+        if (pipe(fds) != 0) {
+            printf("Error creating a pipe\n");
+            return 1;
+        }
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            close(fds[0]);
+            sweep_worker(w, (int)workers, fds[1]);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+    }
+
+    for (w = 0; w < workers; w++) {
+        done = FALSE;
+        while (!done && read(pipes[w], &m, sizeof(m)) == sizeof(m)) {
+            if (m.op < 0) {
+                checked += m.checked;
+                done = TRUE;
+            }
+            else if (count < (int)(sizeof(found) / sizeof(found[0]))) {
+                found[count++] = m;
+            }
+        }
+        close(pipes[w]);
+        waitpid(pids[w], NULL, 0);
+        if (!done) {
+            printf("Worker %d stopped early\n", w);
+            return 1;
+        }
+    }
+
+    qsort(found, (size_t)count, sizeof(found[0]), compare_mismatch);
+    for (op = 0; op < NUM_OPS; op++) {
+        for (wb = 0; wb <= 1; wb++) {
+            if (!selected[op][wb]) {
+                continue;
+            }
+            shown = 0;
+            for (n = 0; n < count; n++) {
+                if (found[n].op != op || found[n].wb != wb || shown == (int)max_reported) {
+                    continue;
+                }
+                if (shown++ == 0) {
+                    printf("%s%s: MISMATCH\n", sweep_ops[op].name, sweep_ops[op].has_byte ? (wb ? ".B" : ".W") : "");
+                    failing++;
+                }
+                printf("  src %04X dst %04X psw %s: expected dst %04X src %04X psw %s, got dst %04X src %04X psw %s\n",
+                    found[n].src, found[n].dst, flag_text(found[n].flags_in, in_text),
+                    found[n].expected_dst, found[n].expected_src, flag_text(found[n].expected_flags, expected_text),
+                    found[n].got_dst, found[n].got_src, flag_text(found[n].got_flags, got_text));
+            }
+            if (shown == 0) {
+                printf("%s%s: ok\n", sweep_ops[op].name, sweep_ops[op].has_byte ? (wb ? ".B" : ".W") : "");
+            }
+        }
+    }
+    printf("%llu case(s) checked, %d instruction form(s) failing\n", checked, failing);
+    return failing != 0;
+}
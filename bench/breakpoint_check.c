@@ -0,0 +1,69 @@
+/**
+ * @file breakpoint_check.c
+ * @brief Check that a breakpoint stops once per execution of the instruction it is on.
+ * @details countdown.xme counts R0 down from 0x4000 with SUB #1,R0 at 1004 and BNE 1004 at
+ *          1006. With the breakpoint on the BNE, every xm23_run() must stop at it with R0 one
+ *          lower than the stop before; the bubble after the taken branch executes nothing and
+ *          must not stop the run again. The stops are checked through CPU_fused() and, with the
+ *          trace on, through CPU().
+ *          Usage: breakpoint_check [countdown.xme]
+ */
+
+#include "../xm23.h"
+#include <stdio.h>
+
+#define STOPS 100           // Breakpoint stops checked on each path
+#define BREAKPOINT 0x1006   // BNE of the countdown loop
+#define START_COUNT 0x4000  // R0 at the first stop, after the first SUB
+
+/**
+ * @brief Run to the breakpoint STOPS times, checking R0 at each stop.
+ * @return Number of stops that were wrong.
+ */
+static int check_stops(xm23_machine* machine, const char* path) {
+    xm23_counters counters;
+    enum xm23_stop stop;
+    unsigned short r0;
+    unsigned int hits;
+    int n, bad = 0;
+
+    xm23_get_counters(machine, &counters);
+    hits = counters.breakpoint_hits;
+    for (n = 1; n <= STOPS; n++) {
+        stop = xm23_run(machine, 0);
+        r0 = xm23_get_register(machine, 0);
+        if (stop != XM23_STOP_BREAKPOINT || r0 != START_COUNT - n) {
+            printf("%s: stop %d returned %d with R0 %04X, expected a breakpoint with R0 %04X\n", path, n, (int)stop, r0,
+                START_COUNT - n);
+            bad++;
+        }
+    }
+    xm23_get_counters(machine, &counters);
+    if (counters.breakpoint_hits - hits != STOPS) {
+        printf("%s: %u breakpoint hits, expected %d\n", path, counters.breakpoint_hits - hits, STOPS);
+        bad++;
+    }
+    return bad;
+}
+
+int main(int argc, char* argv[]) {
+    const char* filename = argc > 1 ? argv[1] : "workloads/countdown.xme";
+    xm23_machine* machine = xm23_create();
+    int bad = 0;
+
+    if (machine == NULL || !xm23_load_file(machine, filename)) {
+        printf("Cannot load %s\n", filename);
+        return 1;
+    }
+    xm23_set_breakpoint(machine, BREAKPOINT);
+    bad += check_stops(machine, "fused");
+
+    xm23_reset(machine);
+    xm23_set_trace(1);
+    bad += check_stops(machine, "CPU()");
+    xm23_set_trace(0);
+
+    xm23_destroy(machine);
+    printf("breakpoint-check: %s\n", bad ? "FAILED" : "OK");
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+/**
+ * @file microbench.c
+ * @brief Microbenchmarks for the decode, execute, PSW and bus functions of the emulator.
+ * @details Every function is driven in isolation over a table of pseudo-random but
+ *          realistic operands (registers R0-R6, all constants, word and byte modes,
+ *          every branch condition taken and not taken). Each benchmark reports ns/op and,
+ *          when the host allows perf_event_open(), retired host instructions per op.
+ *          Usage: microbench [-n iterations] [name filter]
+ */
+
+#include "../Emulator.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define OPS_LEN 1024            // Operand table size, a power of two
+#define DEFAULT_ITERATIONS (1 << 22)
+#define REPEATS 3               // Best of REPEATS runs is reported
+
+typedef void (*handler_fn)();
+
+static InstructionInfo ops[OPS_LEN];
+static unsigned short words[OPS_LEN];
+static unsigned int rng_state = 0x2024u;
+static int perf_fd = -1;
+static unsigned long iterations = DEFAULT_ITERATIONS;
+static const char* name_filter = NULL;
+static double loop_overhead_ns = 0.0;
+static double loop_overhead_inst = 0.0; // Host instructions of the driving loop per op, 0 without perf counters
+volatile unsigned int sink;
+
+/**
+ * @brief Deterministic xorshift generator so runs are comparable.
+ */
+static unsigned int rnd() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static unsigned long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void perf_open() {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    perf_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void perf_begin() {
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static long long perf_end() {
+    long long count = -1;
+
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf_fd, &count, sizeof(count)) != sizeof(count)) {
+            count = -1;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Give the general purpose registers random values, leaving PC alone.
+ */
+static void randomize_registers() {
+    int reg;
+
+    for (reg = 0; reg < 7; reg++) {
+        regfile[0][reg] = (unsigned short)rnd();
+    }
+    PC = 0x1000;
+}
+
+/* Encoding generators: random registers R0-R6 and every constant */
+static unsigned short enc_alu(int opcode, int r_c, int w_b) {
+    return (unsigned short)(0x4000 | (opcode << 8) | (r_c << 7) | (w_b << 6) | ((r_c ? rnd() % 8 : rnd() % 7) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_single(int opcode, int w_b) { // SRA, RRC, SWPB, SXT
+    return (unsigned short)(0x4D00 | (w_b << 6) | (opcode << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_mov(int w_b) {
+    return (unsigned short)(0x4C00 | (w_b << 6) | ((rnd() % 7) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_swap() {
+    return (unsigned short)(0x4C80 | ((rnd() % 7) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_movl(int opcode) {
+    return (unsigned short)(0x6000 | (opcode << 11) | ((rnd() & 0xFF) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_ld_st(int store, int w_b) {
+    unsigned short mode = (unsigned short)(rnd() % 5); // none, post-inc, post-dec, pre-inc, pre-dec
+    unsigned short prpo = mode >= 3, dec = mode == 2 || mode == 4, inc = mode == 1 || mode == 3;
+    return (unsigned short)((store ? 0x5C00 : 0x5800) | (prpo << 9) | (dec << 8) | (inc << 7) | (w_b << 6) |
+        ((rnd() % 7) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_ldr_str(int store, int w_b) {
+    return (unsigned short)((store ? 0xC000 : 0x8000) | ((rnd() & 0x7F) << 7) | (w_b << 6) | ((rnd() % 7) << 3) | (rnd() % 7));
+}
+
+static unsigned short enc_branch(int condition) { // condition 0-7 is BEQ-BRA, -1 is BL
+    if (condition < 0) {
+        return (unsigned short)(rnd() & 0x1FFF);
+    }
+    return (unsigned short)(0x2000 | (condition << 10) | (rnd() & 0x3FF));
+}
+
+/**
+ * @brief A realistic instruction mix for the decoder benchmarks.
+ */
+static unsigned short enc_mix() {
+    unsigned int pick = rnd() % 100;
+
+    if (pick < 40) {
+        return enc_alu(rnd() % 12, rnd() & 1, rnd() & 1);
+    }
+    if (pick < 48) {
+        return enc_mov(rnd() & 1);
+    }
+    if (pick < 63) {
+        return enc_movl(rnd() % 4);
+    }
+    if (pick < 78) {
+        return enc_ld_st(rnd() & 1, rnd() & 1);
+    }
+    if (pick < 85) {
+        return enc_ldr_str(rnd() & 1, rnd() & 1);
+    }
+    return enc_branch((int)(rnd() % 9) - 1);
+}
+
+/**
+ * @brief Decode an encoding the way D0() does, without touching the pipeline registers.
+ */
+static InstructionInfo decode(unsigned short instruction) {
+    IR = instruction;
+    cpu_clock = 1; // D0() treats clock 0 as the pipeline fill NOP
+    diag_index = 0;
+    D0();
+    return global_inst_operands;
+}
+
+/**
+ * @brief Report one benchmark line.
+ */
+static void report(const char* name, unsigned long long best_ns, long long best_inst) {
+    double ns = (double)best_ns / iterations - loop_overhead_ns;
+    double inst = (double)best_inst / iterations - loop_overhead_inst;
+
+    printf("%-34s %10.2f ns/op", name, ns > 0 ? ns : 0.0);
+    if (best_inst >= 0) {
+        printf(" %10.1f inst/op", inst > 0 ? inst : 0.0);
+    }
+    else {
+        printf(" %10s inst/op", "n/a");
+    }
+    printf("\n");
+}
+
+static int selected(const char* name) {
+    return name_filter == NULL || strstr(name, name_filter) != NULL;
+}
+
+/**
+ * @brief Time a handler over the operand table, global_inst_operands is reloaded every op.
+ * @details Kept out of line so that the empty handler used to measure the loop overhead
+ *          goes through exactly the same code as the real handlers.
+ */
+__attribute__((noinline, noclone))
+static unsigned long long time_handler(handler_fn fn, long long* best_inst) {
+    unsigned long long start, best_ns = ~0ull;
+    long long inst;
+    unsigned long i;
+    int repeat;
+
+    *best_inst = -1;
+    for (repeat = 0; repeat < REPEATS; repeat++) {
+        randomize_registers();
+        perf_begin();
+        start = now_ns();
+        for (i = 0; i < iterations; i++) {
+            global_inst_operands = ops[i & (OPS_LEN - 1)];
+            fn();
+        }
+        start = now_ns() - start;
+        inst = perf_end();
+        if (start < best_ns) {
+            best_ns = start;
+            *best_inst = inst;
+        }
+    }
+    return best_ns;
+}
+
+static void bench_handler(const char* name, handler_fn fn) {
+    unsigned long long best_ns;
+    long long best_inst;
+
+    if (!selected(name)) {
+        return;
+    }
+    best_ns = time_handler(fn, &best_inst);
+    report(name, best_ns, best_inst);
+}
+
+static void empty_handler() {
+}
+
+/* E0 and E1 of the memory instructions are benchmarked together */
+static void bench_LD() { ld_effective_addr(); execute_LD(); }
+static void bench_ST() { st_effective_addr(); execute_ST(); }
+static void bench_LDR() { ldr_effective_addr(); execute_LDR(); }
+static void bench_STR() { str_effective_addr(); execute_STR(); }
+
+/* Word-level benchmarks that take the encodings or random words from words[] */
+static void bench_D0() { IR = words[sink++ & (OPS_LEN - 1)]; D0(); }
+static void bench_extract() { InstructionInfo info = extract_inst_operands(words[sink++ & (OPS_LEN - 1)]); sink += info.dst; }
+static void bench_update_psw_word() { unsigned short a = words[sink & (OPS_LEN - 1)], b = words[(sink + 1) & (OPS_LEN - 1)]; update_psw(a, b, a + b, word); sink++; }
+static void bench_update_psw_byte() { unsigned short a = words[sink & (OPS_LEN - 1)] & 0xFF, b = words[(sink + 1) & (OPS_LEN - 1)] & 0xFF; update_psw(a, b, (a + b) & 0xFF, byte); sink++; }
+static void bench_bcd_add() { unsigned short a = words[sink & (OPS_LEN - 1)]; sink += bcd_add(a & 0x0F, (a >> 4) & 0x0F); }
+
+static unsigned short bus_ctrl;
+static int bus_memory;
+static void bench_bus() { unsigned short mbr = words[sink & (OPS_LEN - 1)]; xMC_BUS(words[(sink + 1) & (OPS_LEN - 1)] & 0xFFFE, &mbr, bus_ctrl, bus_memory); sink += mbr; }
+
+/**
+ * @brief Fill the operand table from an encoding generator and benchmark the handler.
+ */
+#define FILL_OPS(expr) for (int n = 0; n < OPS_LEN; n++) { ops[n] = decode(expr); }
+
+static void run_alu_benchmarks() {
+    static const struct { const char* name; int opcode; handler_fn fn; } alu[] = {
+        { "execute_ADD", 0, execute_ADD }, { "execute_ADDC", 1, execute_ADDC }, { "execute_SUB", 2, execute_SUB },
+        { "execute_SUBC", 3, execute_SUBC }, { "execute_DADD", 4, execute_DADD }, { "execute_CMP", 5, execute_CMP },
+        { "execute_XOR", 6, execute_XOR }, { "execute_AND", 7, execute_AND }, { "execute_OR", 8, execute_OR },
+        { "execute_BIT", 9, execute_BIT }, { "execute_BIC", 10, execute_BIC }, { "execute_BIS", 11, execute_BIS }
+    };
+    static const struct { const char* name; int opcode; handler_fn fn; } single[] = {
+        { "execute_SRA", 0, execute_SRA }, { "execute_RRC", 1, execute_RRC },
+        { "execute_SWPB", 3, execute_SWPB }, { "execute_SXT", 4, execute_SXT }
+    };
+    char name[64];
+    int op, r_c, w_b;
+
+    for (op = 0; op < (int)(sizeof(alu) / sizeof(alu[0])); op++) {
+        for (w_b = 0; w_b <= 1; w_b++) {
+            for (r_c = 0; r_c <= 1; r_c++) {
+                sprintf(name, "%s%s %s", alu[op].name, w_b ? ".B" : ".W", r_c ? "#const" : "reg");
+                FILL_OPS(enc_alu(alu[op].opcode, r_c, w_b));
+                bench_handler(name, alu[op].fn);
+            }
+        }
+    }
+    for (w_b = 0; w_b <= 1; w_b++) {
+        sprintf(name, "execute_MOV%s", w_b ? ".B" : ".W");
+        FILL_OPS(enc_mov(w_b));
+        bench_handler(name, execute_MOV);
+    }
+    FILL_OPS(enc_swap());
+    bench_handler("execute_SWAP", execute_SWAP);
+    for (op = 0; op < (int)(sizeof(single) / sizeof(single[0])); op++) {
+        for (w_b = 0; w_b <= (single[op].opcode < 3); w_b++) { // SWPB and SXT are word only
+            sprintf(name, "%s%s", single[op].name, w_b ? ".B" : ".W");
+            FILL_OPS(enc_single(single[op].opcode, w_b));
+            bench_handler(name, single[op].fn);
+        }
+    }
+}
+
+static void run_move_and_cc_benchmarks() {
+    static const char* movl_names[] = { "execute_MOVL", "execute_MOVLZ", "execute_MOVLS", "execute_MOVH" };
+    static const handler_fn movl_fns[] = { execute_MOVL, execute_MOVLZ, execute_MOVLS, execute_MOVH };
+    int op;
+
+    for (op = 0; op < 4; op++) {
+        FILL_OPS(enc_movl(op));
+        bench_handler(movl_names[op], movl_fns[op]);
+    }
+    FILL_OPS((unsigned short)(0x4DA0 | (rnd() & 0x17))); // SETCC without SLP
+    bench_handler("execute_SETCC", execute_SETCC);
+    FILL_OPS((unsigned short)(0x4DC0 | (rnd() & 0x1F)));
+    bench_handler("execute_CLRCC", execute_CLRCC);
+}
+
+static void run_memory_benchmarks() {
+    static const handler_fn fns[] = { bench_LD, bench_ST, bench_LDR, bench_STR };
+    static const char* names[] = { "LD (E0+E1)", "ST (E0+E1)", "LDR (E0+E1)", "STR (E0+E1)" };
+    char name[64];
+    int op, w_b;
+
+    for (op = 0; op < 4; op++) {
+        for (w_b = 0; w_b <= 1; w_b++) {
+            sprintf(name, "%s%s", names[op], w_b ? " .B" : " .W");
+            FILL_OPS(op < 2 ? enc_ld_st(op & 1, w_b) : enc_ldr_str(op & 1, w_b));
+            bench_handler(name, fns[op]);
+        }
+    }
+}
+
+static void run_branch_benchmarks() {
+    static const char* names[] = { "BEQ", "BNE", "BC", "BNC", "BN", "BGE", "BLT", "BRA" };
+    // PSW values (c, z, n, v) that make each condition true; the false case flips them
+    static const unsigned short taken_psw[8][4] = {
+        { 0, 1, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 0, 0, 0 },
+        { 0, 0, 1, 0 }, { 0, 0, 1, 1 }, { 0, 0, 1, 0 }, { 0, 0, 0, 0 }
+    };
+    char name[64];
+    int condition, taken;
+
+    FILL_OPS(enc_branch(-1));
+    bench_handler("execute_BL", execute_Branching_inst);
+
+    for (condition = 0; condition < 8; condition++) {
+        FILL_OPS(enc_branch(condition));
+        for (taken = 1; taken >= (condition == 7); taken--) {
+            psw.c = taken_psw[condition][0];
+            psw.z = taken_psw[condition][1];
+            psw.n = taken_psw[condition][2];
+            psw.v = taken_psw[condition][3];
+            if (!taken) {
+                psw.c ^= 1;
+                psw.z ^= 1;
+                psw.n ^= (condition >= 4); // BN, BGE and BLT depend on N
+            }
+            sprintf(name, "execute_%s %s", names[condition], taken ? "taken" : "not taken");
+            bench_handler(name, execute_Branching_inst);
+        }
+    }
+    d_bubble = false;
+    e_bubble = false;
+}
+
+static void run_core_benchmarks() {
+    static const char* bus_names[] = { "xMC_BUS read word", "xMC_BUS read byte", "xMC_BUS write word", "xMC_BUS write byte" };
+    char name[64];
+    int n;
+
+    for (n = 0; n < OPS_LEN; n++) {
+        words[n] = enc_mix();
+    }
+    bench_handler("D0 (instruction mix)", bench_D0);
+    bench_handler("extract_inst_operands", bench_extract);
+
+    for (n = 0; n < OPS_LEN; n++) {
+        words[n] = (unsigned short)rnd();
+    }
+    bench_handler("update_psw word", bench_update_psw_word);
+    bench_handler("update_psw byte", bench_update_psw_byte);
+    bench_handler("bcd_add", bench_bcd_add);
+
+    for (bus_memory = instruction_mem; bus_memory <= data_mem; bus_memory++) {
+        for (bus_ctrl = READ_WORD; bus_ctrl <= WRITE_BYTE; bus_ctrl++) {
+            sprintf(name, "%s %s", bus_names[bus_ctrl], bus_memory == instruction_mem ? "imem" : "dmem");
+            bench_handler(name, bench_bus);
+        }
+    }
+}
+
+/* Machine state comparison, run with fewer iterations since each op covers 64 KB */
+static unsigned char diff_before[BTMEMSIZE], diff_after[BTMEMSIZE];
+static MachineState state_a, state_b;
+static DiffRun diff_runs[DIFF_MAX_RUNS];
+static void bench_diff_memory() { sink += diff_memory(diff_before, diff_after, BTMEMSIZE, diff_runs, DIFF_MAX_RUNS); }
+static void bench_state_capture() { state_capture(&state_a); }
+static void bench_state_equal() { sink += state_equal(&state_a, &state_b); }
+
+static SearchPattern search_pattern;
+static unsigned short search_hits[BTMEMSIZE];
+static void bench_mem_search() { sink += mem_search(diff_after, &search_pattern, diff_before, search_hits, BTMEMSIZE); }
+
+static void run_state_benchmarks() {
+    unsigned long saved_iterations = iterations;
+    enum INST_OR_DATA_MEM search_memory;
+    int n;
+
+    iterations = saved_iterations >> 10 ? saved_iterations >> 10 : 1;
+    for (n = 0; n < BTMEMSIZE; n++) {
+        diff_before[n] = diff_after[n] = (unsigned char)rnd();
+    }
+    bench_handler("diff_memory 64 KB equal", bench_diff_memory);
+    for (n = 0; n < 64; n++) {
+        diff_after[rnd() & (BTMEMSIZE - 1)] ^= 0x5A;
+    }
+    bench_handler("diff_memory 64 KB, 64 changes", bench_diff_memory);
+    bench_handler("state_capture", bench_state_capture);
+    state_capture(&state_a);
+    state_b = state_a;
+    bench_handler("state_equal (lockstep check)", bench_state_equal);
+    (void)search_parse("dw:1234", &search_pattern, &search_memory);
+    bench_handler("mem_search word 64 KB", bench_mem_search);
+    (void)search_parse("db:12 ?4 5? 78", &search_pattern, &search_memory);
+    bench_handler("mem_search masked bytes 64 KB", bench_mem_search);
+    iterations = saved_iterations;
+}
+
+int main(int argc, char* argv[]) {
+    long long overhead_inst;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc) {
+            iterations = strtoul(argv[++arg], NULL, 0);
+        }
+        else {
+            name_filter = argv[arg];
+        }
+    }
+    if (iterations == 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    perf_open();
+    trace_enabled = FALSE;
+
+    // Cost of the driving loop itself, subtracted from every result
+    loop_overhead_ns = (double)time_handler(empty_handler, &overhead_inst) / iterations;
+    if (overhead_inst >= 0) {
+        loop_overhead_inst = (double)overhead_inst / iterations;
+    }
+
+    printf("%lu iterations per benchmark, best of %d, loop overhead %.2f ns/op and %.1f inst/op subtracted, perf counters %s\n\n",
+        iterations, REPEATS, loop_overhead_ns, loop_overhead_inst, perf_fd >= 0 ? "available" : "unavailable");
+
+    run_core_benchmarks();
+    run_alu_benchmarks();
+    run_move_and_cc_benchmarks();
+    run_memory_benchmarks();
+    run_branch_benchmarks();
+    run_state_benchmarks();
+
+    return 0;
+}
@@ -0,0 +1,407 @@
+/**
+ * @file callgraph.c
+ * @brief Call-graph profiler: inclusive and exclusive cycles, instructions and memory accesses per guest function.
+ * @details A shadow call stack follows the program: execute_BL() pushes a frame holding its
+ *          return address, and the first instruction executed at the return address of the
+ *          top frame pops it, whether the callee returned by a MOV or a LD into the PC. Each
+ *          frame is a node of a calling-context tree, one node per distinct call path, so
+ *          recursion and functions called from several places stay apart. E0() hands every
+ *          instruction to callgraph_step(), which charges the clock cycles since the previous
+ *          one (bubbles, skipped CEX slots and sleep included) and the instruction to the
+ *          current node; E1() adds its memory access. Inclusive figures are summed over
+ *          subtrees when the report is written. The report has the call tree, a flat profile
+ *          and a callers/callees table per function, next to a folded-stack file of exclusive
+ *          cycles for flame graph tools. Function names come from an optional symbol map
+ *          with one "address [type] name" line per symbol, as printed by nm. The profiler
+ *          runs the program through CPU(), like the sampling profiler.
+ */
+
+#include "Emulator.h"
+
+typedef struct {
+    unsigned short function;        // Entry address
+    int parent, child, sibling;     // Node indices, -1 for none
+    unsigned int calls;
+    unsigned long long cycles, instructions, memory; // Exclusive
+    unsigned long long inclusive;   // Cycles, filled in by the report
+} CallNode;
+
+typedef struct {
+    int caller;                     // Node to return to
+    unsigned short return_address;
+} CallFrame;
+
+typedef struct {
+    unsigned short address;
+    char name[CALLGRAPH_NAME_LEN];
+} CallSymbol;
+
+typedef struct {
+    unsigned short function;
+    unsigned int calls;
+    unsigned long long cycles, inclusive, instructions, memory;
+} CallFunction;
+
+typedef struct {
+    unsigned short caller, callee;
+    unsigned int calls;
+    unsigned long long inclusive;
+} CallEdge;
+
+int callgraph_enabled = FALSE;
+static CallNode* nodes = NULL;
+static int node_count;
+static int nodes_dropped;           // Calls charged to their caller, past the deepest frame or the last node
+static CallFrame stack[CALLGRAPH_MAX_DEPTH];
+static int depth;
+static int current;                 // Node of the function executing
+static unsigned int last_clock;
+static CallSymbol symbols[CALLGRAPH_MAX_SYMBOLS];
+static int symbol_count;
+static char callgraph_prefix[BUFFER_LEN] = "xm23_callgraph";
+
+/**
+ * @brief Name of the function at address: its symbol, the nearest symbol below plus an offset, or its address.
+ */
+static const char* callgraph_name(unsigned short address) {
+    static char name[CALLGRAPH_NAME_LEN + 8];
+    int low = 0, high = symbol_count - 1, middle, found = -1;
+
+    while (low <= high) { // Last symbol at or below address
+        middle = (low + high) / 2;
+        if (symbols[middle].address <= address) {
+            found = middle;
+            low = middle + 1;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+    if (found < 0) {
+        sprintf(name, "0x%04X", address);
+    }
+    else if (symbols[found].address == address) {
+        return symbols[found].name;
+    }
+    else {
+        sprintf(name, "%s+0x%X", symbols[found].name, address - symbols[found].address);
+    }
+    return name;
+}
+
+static int compare_symbols(const void* a, const void* b) {
+    return (int)((const CallSymbol*)a)->address - (int)((const CallSymbol*)b)->address;
+}
+
+/**
+ * @brief Read a symbol map: one "address [type] name" line per symbol, address in hexadecimal.
+ * @return FALSE if the file cannot be read.
+ */
+int callgraph_symbols(const char* filename) {
+    FILE* in = fopen(filename, "r");
+    char line[BUFFER_LEN], first[BUFFER_LEN], second[BUFFER_LEN], third[BUFFER_LEN];
+    int fields;
+
+    if (in == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    symbol_count = 0;
+    while (fgets(line, sizeof(line), in) != NULL && symbol_count < CALLGRAPH_MAX_SYMBOLS) {
+        fields = sscanf(line, "%255s %255s %255s", first, second, third);
+        if (fields < 2 || first[0] == '#' || !isxdigit((unsigned char)first[0])) {
+            continue;
+        }
+        symbols[symbol_count].address = (unsigned short)strtoul(first, NULL, 16);
+        // "1000 T name" from nm, or just "1000 name"; longer names keep their first CALLGRAPH_NAME_LEN - 1 characters
+        snprintf(symbols[symbol_count].name, CALLGRAPH_NAME_LEN, "%.*s", CALLGRAPH_NAME_LEN - 1,
+            fields == 3 && strlen(second) == 1 ? third : second);
+        symbol_count++;
+    }
+    fclose(in);
+    qsort(symbols, symbol_count, sizeof(symbols[0]), compare_symbols);
+    printf("%d symbols read from %s\n", symbol_count, filename);
+    return TRUE;
+}
+
+/**
+ * @brief Clear the tree and start profiling at the current clock, with the function at PC as the root.
+ * @param prefix Output files are prefix.txt and prefix.folded.
+ * @return FALSE if the tree cannot be allocated.
+ */
+int callgraph_start(const char* prefix) {
+    if (nodes == NULL) {
+        nodes = malloc(sizeof(CallNode) * CALLGRAPH_MAX_NODES);
+        if (nodes == NULL) {
+            printf("Unable to allocate the call tree.\n");
+            return FALSE;
+        }
+    }
+    snprintf(callgraph_prefix, sizeof(callgraph_prefix), "%s", prefix);
+    memset(&nodes[0], 0, sizeof(nodes[0]));
+    nodes[0].function = PC;
+    nodes[0].parent = nodes[0].child = nodes[0].sibling = -1;
+    node_count = 1;
+    nodes_dropped = 0;
+    depth = 0;
+    current = 0;
+    last_clock = cpu_clock;
+    callgraph_enabled = TRUE;
+    return TRUE;
+}
+
+/**
+ * @brief Charge an instruction issued at address, and the cycles since the last one, to the current function.
+ */
+void callgraph_step(unsigned short address) {
+    nodes[current].cycles += cpu_clock - last_clock;
+    last_clock = cpu_clock;
+    if (depth && address == stack[depth - 1].return_address) {
+        current = stack[--depth].caller;
+    }
+    nodes[current].instructions++;
+}
+
+/**
+ * @brief An E1 data memory access by the current function.
+ */
+void callgraph_memory_access() {
+    nodes[current].memory++;
+}
+
+/**
+ * @brief A BL to target, to return to return_address.
+ */
+void callgraph_call(unsigned short return_address, unsigned short target) {
+    int child;
+
+    for (child = nodes[current].child; child >= 0 && nodes[child].function != target; child = nodes[child].sibling);
+    if (child < 0) {
+        if (node_count == CALLGRAPH_MAX_NODES || depth == CALLGRAPH_MAX_DEPTH) {
+            nodes_dropped++;
+            return; // The callee's cost stays with the caller
+        }
+        child = node_count++;
+        memset(&nodes[child], 0, sizeof(nodes[child]));
+        nodes[child].function = target;
+        nodes[child].child = -1;
+        nodes[child].parent = current;
+        nodes[child].sibling = nodes[current].child;
+        nodes[current].child = child;
+    }
+    else if (depth == CALLGRAPH_MAX_DEPTH) {
+        nodes_dropped++;
+        return;
+    }
+    nodes[child].calls++;
+    stack[depth].caller = current;
+    stack[depth++].return_address = return_address;
+    current = child;
+}
+
+static int compare_inclusive(const void* a, const void* b) {
+    unsigned long long left = nodes[*(const int*)a].inclusive, right = nodes[*(const int*)b].inclusive;
+
+    return left < right ? 1 : (left > right ? -1 : 0);
+}
+
+/**
+ * @brief Write node and its subtree, children by decreasing inclusive cycles.
+ */
+static void callgraph_tree(FILE* out, int node, int level, unsigned long long total) {
+    int children[CALLGRAPH_MAX_CHILDREN];
+    int count = 0, child, n;
+
+    fprintf(out, "%6.2f%% %12llu %12llu %8u  %*s%s\n", total ? 100.0 * (double)nodes[node].inclusive / (double)total : 0.0,
+        nodes[node].inclusive, nodes[node].cycles, nodes[node].calls, 2 * level, "", callgraph_name(nodes[node].function));
+    for (child = nodes[node].child; child >= 0; child = nodes[child].sibling) {
+        if (count == CALLGRAPH_MAX_CHILDREN) {
+            fprintf(out, "%*s(more callees not shown)\n", 44 + 2 * level, "");
+            break;
+        }
+        children[count++] = child;
+    }
+    qsort(children, count, sizeof(children[0]), compare_inclusive);
+    for (n = 0; n < count; n++) {
+        callgraph_tree(out, children[n], level + 1, total);
+    }
+}
+
+static int compare_functions(const void* a, const void* b) {
+    unsigned long long left = ((const CallFunction*)a)->inclusive, right = ((const CallFunction*)b)->inclusive;
+
+    return left < right ? 1 : (left > right ? -1 : 0);
+}
+
+static int compare_edges(const void* a, const void* b) {
+    const CallEdge* left = a;
+    const CallEdge* right = b;
+
+    if (left->caller != right->caller) {
+        return (int)left->caller - (int)right->caller;
+    }
+    return (int)left->callee - (int)right->callee;
+}
+
+/**
+ * @brief Write the folded stack of every node with exclusive cycles, outermost function first.
+ */
+static void callgraph_folded(FILE* out) {
+    int path[CALLGRAPH_MAX_DEPTH + 1];
+    int node, length, n;
+
+    for (node = 0; node < node_count; node++) {
+        if (nodes[node].cycles == 0) {
+            continue;
+        }
+        for (length = 0, n = node; n >= 0 && length <= CALLGRAPH_MAX_DEPTH; n = nodes[n].parent) {
+            path[length++] = n;
+        }
+        while (length--) {
+            fprintf(out, "%s%s", callgraph_name(nodes[path[length]].function), length ? ";" : "");
+        }
+        fprintf(out, " %llu\n", nodes[node].cycles);
+    }
+}
+
+/**
+ * @brief Stop profiling and write prefix.txt (call tree, flat profile, callers and callees) and prefix.folded.
+ * @return FALSE if a file cannot be written.
+ */
+int callgraph_stop() {
+    static int function_index[WDMEMSIZE];    // Entry in functions + 1 for each entry address, 0 for none
+    static CallFunction functions[CALLGRAPH_MAX_NODES];
+    static CallEdge edges[CALLGRAPH_MAX_NODES];
+    char filename[BUFFER_LEN + 8];
+    int function_count = 0, edge_count = 0, node, n, f, e;
+    unsigned long long total;
+    FILE* out;
+
+    if (!callgraph_enabled) {
+        return TRUE;
+    }
+    callgraph_enabled = FALSE;
+    nodes[current].cycles += cpu_clock - last_clock; // The cycles since the last instruction
+
+    for (node = 0; node < node_count; node++) {
+        nodes[node].inclusive = nodes[node].cycles;
+    }
+    for (node = node_count - 1; node > 0; node--) { // Children always come after their parent
+        nodes[nodes[node].parent].inclusive += nodes[node].inclusive;
+    }
+    total = nodes[0].inclusive;
+
+    // Flat profile: inclusive cycles only count the outermost activation of a recursive function
+    memset(function_index, 0, sizeof(function_index));
+    for (node = 0; node < node_count; node++) {
+        f = function_index[nodes[node].function >> 1] - 1;
+        if (f < 0) {
+            f = function_count++;
+            memset(&functions[f], 0, sizeof(functions[f]));
+            functions[f].function = nodes[node].function;
+            function_index[nodes[node].function >> 1] = f + 1;
+        }
+        functions[f].calls += nodes[node].calls;
+        functions[f].cycles += nodes[node].cycles;
+        functions[f].instructions += nodes[node].instructions;
+        functions[f].memory += nodes[node].memory;
+        for (n = nodes[node].parent; n >= 0 && nodes[n].function != nodes[node].function; n = nodes[n].parent);
+        if (n < 0) {
+            functions[f].inclusive += nodes[node].inclusive;
+        }
+        if (node > 0) {
+            edges[edge_count].caller = nodes[nodes[node].parent].function;
+            edges[edge_count].callee = nodes[node].function;
+            edges[edge_count].calls = nodes[node].calls;
+            edges[edge_count++].inclusive = nodes[node].inclusive;
+        }
+    }
+    qsort(functions, function_count, sizeof(functions[0]), compare_functions);
+    qsort(edges, edge_count, sizeof(edges[0]), compare_edges);
+    for (e = 0, n = 1; n < edge_count; n++) { // Merge the edges of different call paths
+        if (edges[n].caller == edges[e].caller && edges[n].callee == edges[e].callee) {
+            edges[e].calls += edges[n].calls;
+            edges[e].inclusive += edges[n].inclusive;
+        }
+        else {
+            edges[++e] = edges[n];
+        }
+    }
+    edge_count = edge_count ? e + 1 : 0;
+
+    sprintf(filename, "%s.txt", callgraph_prefix);
+    out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    fprintf(out, "Call tree, %llu cycles, %d call paths%s\n\n", total, node_count,
+        nodes_dropped ? " (stack or tree full, some calls charged to their caller)" : "");
+    fprintf(out, "  Total    Inclusive    Exclusive    Calls  Function\n");
+    callgraph_tree(out, 0, 0, total);
+
+    fprintf(out, "\nFlat profile\n\n");
+    fprintf(out, "  Total    Inclusive    Exclusive    Calls Instructions  Memory  Function\n");
+    for (f = 0; f < function_count; f++) {
+        fprintf(out, "%6.2f%% %12llu %12llu %8u %12llu %7llu  %s\n",
+            total ? 100.0 * (double)functions[f].inclusive / (double)total : 0.0, functions[f].inclusive,
+            functions[f].cycles, functions[f].calls, functions[f].instructions, functions[f].memory,
+            callgraph_name(functions[f].function));
+    }
+
+    fprintf(out, "\nCallers and callees (calls, inclusive cycles of the calls)\n");
+    for (f = 0; f < function_count; f++) {
+        fprintf(out, "\n");
+        for (e = 0; e < edge_count; e++) {
+            if (edges[e].callee == functions[f].function) {
+                fprintf(out, "    %8u %12llu      %s\n", edges[e].calls, edges[e].inclusive, callgraph_name(edges[e].caller));
+            }
+        }
+        fprintf(out, "[%s] %u calls, %llu cycles\n", callgraph_name(functions[f].function), functions[f].calls,
+            functions[f].inclusive);
+        for (e = 0; e < edge_count; e++) {
+            if (edges[e].caller == functions[f].function) {
+                fprintf(out, "    %8u %12llu          %s\n", edges[e].calls, edges[e].inclusive, callgraph_name(edges[e].callee));
+            }
+        }
+    }
+    if (fclose(out) != 0) {
+        printf("Error writing file >%s<\n\n", filename);
+        return FALSE;
+    }
+
+    sprintf(filename, "%s.folded", callgraph_prefix);
+    out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    callgraph_folded(out);
+    fclose(out);
+
+    printf("Call graph of %d functions written to %s.txt and %s.folded\n\n", function_count, callgraph_prefix,
+        callgraph_prefix);
+    return TRUE;
+}
+
+/**
+ * @brief Interactive start/stop of the call-graph profiler.
+ */
+void callgraph_menu() {
+    char prefix[BUFFER_LEN], map[BUFFER_LEN];
+    int ch;
+
+    if (callgraph_enabled) {
+        callgraph_stop();
+        return;
+    }
+
+    printf("Enter the output prefix and a symbol map, or - for none (prefix map: prog prog.map): ");
+    if (scanf("%255s %255s", prefix, map) != 2) {
+        printf("Invalid input.\n\n");
+    }
+    else if ((strcmp(map, "-") == 0 || callgraph_symbols(map)) && callgraph_start(prefix)) {
+        printf("Call-graph profiler started, the program runs through CPU() while it is on.\n\n");
+    }
+    while ((ch = getchar()) != '\n' && ch != EOF);
+}
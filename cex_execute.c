@@ -0,0 +1,43 @@
+/**
+ * @file cex_execute.c
+ * @brief CEX conditional execution.
+ * @details CEX cond,#T,#F executes the next T instructions if cond holds and skips the F after
+ *          them, or skips the T and executes the F if it does not. The block is kept as a
+ *          predicate mask with one bit per following instruction (bit 0 first, 1 = execute),
+ *          which E0() shifts out as the instructions reach it. A skipped instruction still
+ *          takes its pipeline slot but its handler never runs, so short conditional sequences
+ *          cost no branch bubbles. A taken branch inside the block ends it.
+ */
+
+#include "Emulator.h"
+
+XM_CORE unsigned short cex_mask = 0;  // Predicate bits of the instructions still in the CEX block
+XM_CORE unsigned short cex_count = 0; // Instructions still in the CEX block
+XM_CORE int cex_skipped = FALSE;      // TRUE while E0() is passing over a predicated-off instruction
+
+/**
+ * @brief Evaluate every CEX condition at once against the PSW flags.
+ * @return A mask with bit cond set for each condition that holds.
+ * @details The odd conditions are the complements of the even ones (NE of EQ, CC of CS, ...,
+ *          FL of TR), so only the even ones are computed and the odd bits are derived.
+ */
+unsigned short cex_conditions(unsigned short c, unsigned short z, unsigned short n, unsigned short v) {
+    unsigned short ge = (n == v);
+    unsigned short even = (unsigned short)(z | (c << 2) | (n << 4) | (v << 6) |
+        ((c & !z) << 8) | (ge << 10) | ((ge & !z) << 12) | (1 << 14));
+
+    return even | (unsigned short)((~even & 0x5555) << 1);
+}
+
+/**
+ * @brief Execute CEX: load the predicate mask for the following T+F instructions.
+ */
+void execute_CEX() {
+    unsigned short inst = global_inst_operands.instruct_val;
+    unsigned short holds = (cex_conditions(psw.c, psw.z, psw.n, psw.v) >> CEX_COND(inst)) & 1;
+    unsigned short true_block = (unsigned short)((1 << CEX_TRUE_COUNT(inst)) - 1);
+
+    cex_count = CEX_TRUE_COUNT(inst) + CEX_FALSE_COUNT(inst);
+    // holds - 1 is 0 when the condition holds and all ones when it does not
+    cex_mask = (true_block ^ (unsigned short)(holds - 1)) & (unsigned short)((1 << cex_count) - 1);
+}
@@ -0,0 +1,320 @@
+/**
+ * @file coverage.c
+ * @brief Guest code coverage: instruction hit counts, branch outcomes and an AFL-style edge map.
+ * @details While coverage_enabled is set, E0() (and the fused loop) counts every executed
+ *          instruction by address, and the branch handlers report each BL and conditional
+ *          branch with its outcome through coverage_branch(). That counts taken branches by
+ *          address and bumps the edge map bucket of (previous block ^ this block), where a
+ *          block is named by a hash of its first address, as AFL does. A predicated-off
+ *          instruction of a CEX block is not counted. Saved coverage is merged by adding the
+ *          counts (saturating), so a file shared by a whole regression suite ends up holding
+ *          the union of its runs; the file is locked while it is updated. The report is an
+ *          lcov tracefile with instruction addresses as line numbers: DA per instruction,
+ *          BRDA for the taken and not-taken outcome of each conditional branch, and FN/FNDA
+ *          per basic block, so genhtml shows block coverage the way it shows functions.
+ *          The maps are per core. Each core of a multicore run counts into its own, and adds
+ *          them to those of the thread that started the run as it finishes, so edges never
+ *          join the control flows of two cores.
+ */
+
+#include "Emulator.h"
+#include <pthread.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#define COVERAGE_MAGIC "XM23COV"
+#define COVERAGE_VERSION 1
+#define COVERAGE_HASH 40503u // 2^16 / golden ratio, spreads neighbouring addresses over the map
+
+int coverage_enabled = FALSE;
+XM_CORE unsigned int coverage_hits[WDMEMSIZE];          // Executions of each instruction word
+static XM_CORE unsigned int coverage_taken[WDMEMSIZE];  // Taken outcomes of the branch at each word
+static XM_CORE unsigned char coverage_edges[COV_EDGE_MAP_SIZE];
+static XM_CORE unsigned short coverage_previous = 0;    // Hashed block of the last branch destination, shifted
+
+// Maps of the thread running the cores, which each core adds its own to when it finishes
+static unsigned int* total_hits;
+static unsigned int* total_taken;
+static unsigned char* total_edges;
+static pthread_mutex_t total_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Record a BL or conditional branch at from, continuing at to.
+ */
+void coverage_branch(unsigned short from, unsigned short to, int taken) {
+    unsigned short block = (unsigned short)((to >> 1) * COVERAGE_HASH);
+
+    if (taken) {
+        coverage_taken[from >> 1]++;
+    }
+    coverage_edges[(block ^ coverage_previous) & (COV_EDGE_MAP_SIZE - 1)]++;
+    coverage_previous = block >> 1; // Keeps A->B and B->A apart
+}
+
+/**
+ * @brief Record count more iterations of a loop from first to the branch at branch, taken back to first.
+ * @details idle_skip() calls this for the iterations it skips. It has run one iteration through
+ *          CPU() first, so the previous block is already the loop's own.
+ */
+void coverage_loop(unsigned short first, unsigned short branch, unsigned int count) {
+    unsigned short block = (unsigned short)((first >> 1) * COVERAGE_HASH);
+    unsigned int word;
+
+    for (word = first >> 1; word <= (unsigned int)(branch >> 1); word++) {
+        coverage_hits[word] += count;
+    }
+    coverage_taken[branch >> 1] += count;
+    coverage_edges[(block ^ coverage_previous) & (COV_EDGE_MAP_SIZE - 1)] += (unsigned char)count; // Wraps like count increments
+    coverage_previous = block >> 1;
+}
+
+/**
+ * @brief Clear every count.
+ */
+void coverage_reset() {
+    memset(coverage_hits, 0, sizeof(coverage_hits));
+    memset(coverage_taken, 0, sizeof(coverage_taken));
+    memset(coverage_edges, 0, sizeof(coverage_edges));
+    coverage_previous = 0;
+}
+
+static unsigned int add_saturated(unsigned int a, unsigned int b) {
+    return a + b < a ? 0xFFFFFFFFu : a + b;
+}
+
+/**
+ * @brief Add one set of maps to another, saturating.
+ */
+static void coverage_add(unsigned int* hits, unsigned int* taken, unsigned char* edges,
+                         const unsigned int* more_hits, const unsigned int* more_taken, const unsigned char* more_edges) {
+    unsigned int n, sum;
+
+    for (n = 0; n < WDMEMSIZE; n++) {
+        hits[n] = add_saturated(hits[n], more_hits[n]);
+        taken[n] = add_saturated(taken[n], more_taken[n]);
+    }
+    for (n = 0; n < COV_EDGE_MAP_SIZE; n++) {
+        sum = (unsigned int)edges[n] + more_edges[n];
+        edges[n] = sum > 0xFF ? 0xFF : (unsigned char)sum;
+    }
+}
+
+/**
+ * @brief Make the calling thread's maps the ones coverage_core_finish() adds to.
+ */
+void coverage_cores_start() {
+    total_hits = coverage_hits;
+    total_taken = coverage_taken;
+    total_edges = coverage_edges;
+}
+
+/**
+ * @brief Add the calling core's counts to the maps of the thread that started the cores.
+ */
+void coverage_core_finish() {
+    pthread_mutex_lock(&total_lock);
+    coverage_add(total_hits, total_taken, total_edges, coverage_hits, coverage_taken, coverage_edges);
+    pthread_mutex_unlock(&total_lock);
+}
+
+/**
+ * @brief Add coverage saved in an open file to the current counts.
+ * @return FALSE if the file is not a coverage file.
+ */
+static int coverage_add_from(FILE* in) {
+    static unsigned int hits[WDMEMSIZE], taken[WDMEMSIZE];
+    static unsigned char edges[COV_EDGE_MAP_SIZE];
+    char magic[sizeof(COVERAGE_MAGIC) - 1];
+    unsigned int version;
+
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, COVERAGE_MAGIC, sizeof(magic)) != 0 ||
+        fread(&version, sizeof(version), 1, in) != 1 || version != COVERAGE_VERSION ||
+        fread(hits, sizeof(hits), 1, in) != 1 || fread(taken, sizeof(taken), 1, in) != 1 ||
+        fread(edges, sizeof(edges), 1, in) != 1) {
+        return FALSE;
+    }
+    coverage_add(coverage_hits, coverage_taken, coverage_edges, hits, taken, edges);
+    return TRUE;
+}
+
+/**
+ * @brief Add the coverage saved in filename to the current counts.
+ * @return FALSE if the file cannot be read or is not a coverage file.
+ */
+int coverage_load(const char* filename) {
+    FILE* in = fopen(filename, "rb");
+    int ok;
+
+    if (in == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    ok = coverage_add_from(in);
+    fclose(in);
+    if (!ok) {
+        printf("%s is not an XM-23 coverage file\n", filename);
+    }
+    return ok;
+}
+
+/**
+ * @brief Merge the current counts into filename, creating it if needed.
+ * @details The file is locked from reading to writing, so runs in parallel can share it.
+ *          The current counts end up holding the merged result.
+ * @return FALSE if the file cannot be updated.
+ */
+int coverage_save(const char* filename) {
+    unsigned int version = COVERAGE_VERSION;
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    FILE* file;
+    int ok;
+
+    if (fd < 0 || flock(fd, LOCK_EX) != 0 || (file = fdopen(fd, "r+b")) == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return FALSE;
+    }
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) != 0) { // An existing result to merge with
+        rewind(file);
+        if (!coverage_add_from(file)) {
+            printf("%s is not an XM-23 coverage file\n", filename);
+            fclose(file); // Also releases the lock
+            return FALSE;
+        }
+    }
+
+    rewind(file);
+    ok = fwrite(COVERAGE_MAGIC, 1, sizeof(COVERAGE_MAGIC) - 1, file) == sizeof(COVERAGE_MAGIC) - 1;
+    ok = ok && fwrite(&version, sizeof(version), 1, file) == 1;
+    ok = ok && fwrite(coverage_hits, sizeof(coverage_hits), 1, file) == 1;
+    ok = ok && fwrite(coverage_taken, sizeof(coverage_taken), 1, file) == 1;
+    ok = ok && fwrite(coverage_edges, sizeof(coverage_edges), 1, file) == 1;
+    ok = (fflush(file) == 0) && ok;
+    fclose(file);
+    if (!ok) {
+        printf("Error writing file >%s<\n\n", filename);
+    }
+    return ok;
+}
+
+/**
+ * @brief TRUE for a BL or conditional branch, which end a basic block.
+ */
+static int is_branch(unsigned short instruction) {
+    return FIRST_3_BITS(instruction) <= 0x01;
+}
+
+/**
+ * @brief TRUE for a branch that can go either way, every branch but BL and BRA.
+ */
+static int is_conditional(unsigned short instruction) {
+    return FIRST_3_BITS(instruction) == 0x01 && OTHER_BRANCH_CHECK(instruction) != 0x07;
+}
+
+/**
+ * @brief Address a BL or branch at address continues at when taken.
+ */
+static unsigned short branch_target(unsigned short address, unsigned short instruction) {
+    unsigned short offset;
+
+    if (FIRST_3_BITS(instruction) == 0x00) {
+        offset = BL_OFFSET(instruction);
+        offset = (offset & 0x1000) ? (offset | 0xE000) : offset;
+    }
+    else {
+        offset = OTHER_BRANCHES_OFFSET(instruction);
+        offset = (offset & 0x0200) ? (offset | 0xFC00) : offset;
+    }
+    return (unsigned short)(address + PC_INCREMENT + (offset << 1));
+}
+
+/**
+ * @brief Write an lcov tracefile of the current counts.
+ * @param source Name given as the source file (SF), usually the .xme the image came from.
+ * @details Code is every non-zero instruction word plus any word that executed. A basic block
+ *          starts at the first word of a run of code, at a branch target, and after a branch;
+ *          its hit count is that of its first instruction.
+ * @return FALSE if the file cannot be written.
+ */
+int coverage_report(const char* filename, const char* source) {
+    static unsigned char is_code[WDMEMSIZE], is_leader[WDMEMSIZE];
+    unsigned int word, end, lines = 0, lines_hit = 0, blocks = 0, blocks_hit = 0, branches = 0, branches_hit = 0;
+    unsigned int taken, not_taken, edges = 0;
+    unsigned short instruction;
+    FILE* out;
+
+    for (word = 0; word < WDMEMSIZE; word++) {
+        is_code[word] = imemory.wdmem[word] != 0 || coverage_hits[word] != 0;
+    }
+    memset(is_leader, 0, sizeof(is_leader));
+    for (word = 0; word < WDMEMSIZE; word++) {
+        if (!is_code[word]) {
+            continue;
+        }
+        instruction = imemory.wdmem[word];
+        if (word == 0 || !is_code[word - 1] || is_branch(imemory.wdmem[word - 1])) {
+            is_leader[word] = TRUE;
+        }
+        if (is_branch(instruction)) {
+            is_leader[branch_target((unsigned short)(word << 1), instruction) >> 1] = TRUE;
+        }
+    }
+
+    out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    fprintf(out, "TN:xm23\nSF:%s\n", source);
+
+    // Basic blocks as functions, named by their address range
+    for (word = 0; word < WDMEMSIZE; word = end) {
+        if (!is_code[word] || !is_leader[word]) {
+            end = word + 1;
+            continue;
+        }
+        for (end = word + 1; end < WDMEMSIZE && is_code[end] && !is_leader[end]; end++);
+        fprintf(out, "FN:%u,block_%04X_%04X\nFNDA:%u,block_%04X_%04X\n", word << 1, word << 1, (end - 1) << 1,
+            coverage_hits[word], word << 1, (end - 1) << 1);
+        blocks++;
+        blocks_hit += coverage_hits[word] != 0;
+    }
+    fprintf(out, "FNF:%u\nFNH:%u\n", blocks, blocks_hit);
+
+    for (word = 0; word < WDMEMSIZE; word++) {
+        if (!is_code[word] || !is_conditional(imemory.wdmem[word])) {
+            continue;
+        }
+        taken = coverage_taken[word];
+        not_taken = coverage_hits[word] - taken;
+        if (coverage_hits[word] == 0) {
+            fprintf(out, "BRDA:%u,0,0,-\nBRDA:%u,0,1,-\n", word << 1, word << 1);
+        }
+        else {
+            fprintf(out, "BRDA:%u,0,0,%u\nBRDA:%u,0,1,%u\n", word << 1, taken, word << 1, not_taken);
+        }
+        branches += 2;
+        branches_hit += (taken != 0) + (not_taken != 0);
+    }
+    fprintf(out, "BRF:%u\nBRH:%u\n", branches, branches_hit);
+
+    for (word = 0; word < WDMEMSIZE; word++) {
+        if (is_code[word]) {
+            fprintf(out, "DA:%u,%u\n", word << 1, coverage_hits[word]);
+            lines++;
+            lines_hit += coverage_hits[word] != 0;
+        }
+    }
+    fprintf(out, "LF:%u\nLH:%u\nend_of_record\n", lines, lines_hit);
+    fclose(out);
+
+    for (word = 0; word < COV_EDGE_MAP_SIZE; word++) {
+        edges += coverage_edges[word] != 0;
+    }
+    printf("Coverage: %u of %u instructions, %u of %u blocks, %u of %u branch outcomes, %u edge buckets\n",
+        lines_hit, lines, blocks_hit, blocks, branches_hit, branches, edges);
+    return TRUE;
+}
@@ -1,88 +1,176 @@
-/**
- * @file cpu.c
- * @brief CPU simulation functions.
- * @details This file contains functions to simulate CPU behavior.
- * @date 2024-06-23
- * @autho Temitope Onafalujo
- */
-
-#include "Emulator.h"
-
-unsigned int cpu_clock;
-
-/**
- * @brief Simulate the CPU clock and instruction execution.
- */
-void CPU() {
-    static int header_printed = FALSE; // Static variable to keep track of header printing
-    static int mem_exec_stage = FALSE; // used to know when E1 is to be executed
-
-    if (!header_printed) {
-#ifdef DEBUG
-        printf("%-10s %-10s %-15s %-10s %-10s %-10s\n", "Clock", "PC", "Instruction", "Fetch", "Decode", "Execute");
-#endif
-        header_printed = TRUE; // Set the variable to 1 after printing the header
-    }
-
-    // printf("Start PC: %04x Clk: %d\n", PC, cpu_clock);
-    if (cpu_clock % 2 == 0) { // even clock tick
-
-        if (!d_bubble) {
-            f0(); //IMAR <- PC, PC <- PC + 2
-
-            if (mem_exec_stage == TRUE) {
-                E1();
-                mem_exec_stage = FALSE; //resetting the stage to allow E0() run first.
-            }
-
-            D0(); //decode IMBR of the previous odd clock-tick
-            diag_index++;
-            cpu_clock++;
-        }
-        else {
-            IR = NOP;
-            d_bubble = false;
-        }
-    }
-    else { // odd clock tick
-        if (!e_bubble) {
-            f1();
-            E0();
-            cpu_clock++;
-            // Check if the instruction is a memory access instruction and set the stage
-            if (global_inst_operands.instruction_type == LD_EXEC ||
-                global_inst_operands.instruction_type == ST_EXEC ||
-                global_inst_operands.instruction_type == LDR_EXEC ||
-                global_inst_operands.instruction_type == STR_EXEC) {
-                mem_exec_stage = TRUE; // Set the stage to execute E1 on the next even tick
-            }
-
-            // Print diagnostic info after odd clock tick (complete cycle)
-#ifdef DEBUG
-            int index = diag_index - 1;
-            for (index; index < (diag_index + 1); index++) {
-
-                printf("%-10u %-10X %-15X %-10s %-10s %-10s\n",
-                    diagnostics[index].clock,
-                    diagnostics[index].pc,
-                    diagnostics[index].instruction,
-                    diagnostics[index].fetch,
-                    diagnostics[index].decode,
-                    diagnostics[index].execute);
-
-            }
-#endif
-            diag_index++;
-
-
-            if (last_executed_address == breakpoint_address) {
-                program_running = FALSE; // Stop the program
-            }
-        }
-        else {
-            e_bubble = false;
-        }
-    }
-    // printf("End PC: %04x Clk: %d\n\n", PC, cpu_clock);
-    // previously increment cpu_clock here
-}
+/**
+ * @file cpu.c
+ * @brief CPU simulation functions.
+ * @details This file contains functions to simulate CPU behavior.
+ * @date 2024-06-23
+ * @autho Temitope Onafalujo
+ */
+
+#include "Emulator.h"
+
+XM_CORE unsigned int cpu_clock;
+
+XM_CORE union mem imemory = { 0 };
+XM_CORE union mem dmemory = { 0 };
+
+// Define the 2D array regfile
+XM_CORE unsigned short regfile[NUM_VALUES][NUM_REG_OR_CONS] = {
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000},
+    {0x0000, 0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0xFFFF}
+};
+
+XM_CORE int program_running = TRUE; // Global flag to indicate if the program is running
+XM_CORE unsigned short breakpoint_address = INVALID; // Initialized to an invalid address
+XM_CORE int breakpoint_set = FALSE; // Flag to indicate if a breakpoint has been set
+
+XM_CORE bool d_bubble = false;
+XM_CORE bool e_bubble = false;
+
+static DiagnosticInfo diagnostic_buffer[diagnostic_index]; // The main thread's trace buffer
+XM_CORE DiagnosticInfo* diagnostics = diagnostic_buffer;   // Cores on other threads point it at a small ring
+XM_CORE int diagnostic_size = diagnostic_index;
+XM_CORE int diag_index = 0;
+
+XM_CORE int mem_exec_stage = FALSE; // used to know when E1 is to be executed
+
+/**
+ * @brief Sleep until the next scheduled event (PSW.SLP set), then wake.
+ * @details A sleeping CPU fetches nothing, so instead of ticking through the idle cycles the
+ *          clock jumps straight to the first slot boundary at or after the next event. The
+ *          events due then are dispatched and, like the interrupt they stand for, wake the
+ *          CPU, which carries on with the instruction already in IR. With nothing pending the
+ *          CPU could never wake, so the run stops instead.
+ */
+void cpu_sleep() {
+    unsigned int when;
+
+    if (!sched_next_event(&when)) {
+        printf("CPU asleep with no pending events at clock %u\n", cpu_clock);
+        program_running = FALSE;
+        return;
+    }
+    if ((int)(when - cpu_clock) > 0) {
+#ifdef DEBUG
+        if (trace_enabled) {
+            printf("Asleep from clock %u to %u\n", cpu_clock, (when + 1) & ~1u);
+        }
+#endif
+        cpu_clock = (when + 1) & ~1u; // Whole instruction slots only
+    }
+    sched_dispatch();
+    psw.slp = clr_bit;
+}
+
+/**
+ * @brief Simulate the CPU clock and instruction execution.
+ */
+void CPU() {
+    static int header_printed = -1; // Disassembly setting the header was printed with, -1 until printed
+#ifdef DEBUG
+    static XM_CORE int e1_dst = -1; // register loaded by E1 this cycle, used by the trace register filter
+#endif
+
+    if (header_printed != trace_disasm && trace_enabled) {
+#ifdef DEBUG
+        printf("%-10s %-10s %-15s %-10s %-10s %-10s%s\n", "Clock", "PC", "Instruction", "Fetch", "Decode", "Execute",
+            trace_disasm ? " Disassembly" : "");
+#endif
+        header_printed = trace_disasm; // Print the header again only if the columns change
+    }
+
+    // printf("Start PC: %04x Clk: %d\n", PC, cpu_clock);
+    if (cpu_clock % 2 == 0) { // even clock tick
+
+        if (psw.slp) { // Fetching stops while the CPU sleeps
+            cpu_sleep();
+        }
+        else if (!d_bubble) {
+            f0(); //IMAR <- PC, PC <- PC + 2
+
+#ifdef DEBUG
+            e1_dst = -1;
+#endif
+            if (mem_exec_stage == TRUE) {
+                E1();
+                if (timing_active) {
+                    cpu_clock += timing_data(DMAR);
+                }
+#ifdef DEBUG
+                if (global_inst_operands.instruction_type == LD_EXEC || global_inst_operands.instruction_type == LDR_EXEC) {
+                    e1_dst = global_inst_operands.dst;
+                }
+#endif
+                mem_exec_stage = FALSE; //resetting the stage to allow E0() run first.
+            }
+
+            D0(); //decode IMBR of the previous odd clock-tick
+            diag_index++;
+            cpu_clock++;
+            if (timing_active) { // I-memory wait states of the F0 fetch, once D0 has seen clock 0
+                cpu_clock += timing_fetch(IMAR);
+            }
+        }
+        else {
+            IR = NOP;
+            d_bubble = false;
+        }
+    }
+    else { // odd clock tick
+        if (!e_bubble) {
+            f1();
+            E0();
+            cpu_clock++;
+            if (timing_active) { // Execute latency and branch penalty
+                cpu_clock += timing_execute();
+            }
+            // Check if the instruction is a memory access instruction and set the stage
+            if (!cex_skipped && (global_inst_operands.instruction_type == LD_EXEC ||
+                global_inst_operands.instruction_type == ST_EXEC ||
+                global_inst_operands.instruction_type == LDR_EXEC ||
+                global_inst_operands.instruction_type == STR_EXEC)) {
+                mem_exec_stage = TRUE; // Set the stage to execute E1 on the next even tick
+            }
+
+            // Print diagnostic info after odd clock tick (complete cycle)
+#ifdef DEBUG
+            if (trace_enabled && trace_filter_pass(e1_dst)) {
+                char disasm_buf[DISASM_BUF_LEN];
+                const char* disasm_text = "";
+                int index = diag_index - 1;
+
+                if (trace_disasm) { // Shown on the E0 line, next to the instruction it describes
+                    disasm_text = disassemble(global_inst_operands.instruct_val, last_executed_address, disasm_buf);
+                }
+                for (; index < (diag_index + 1); index++) {
+
+                    printf("%-10u %-10X %-15X %-10s %-10s %-10s%s%s\n",
+                        diagnostics[index].clock,
+                        diagnostics[index].pc,
+                        diagnostics[index].instruction,
+                        diagnostics[index].fetch,
+                        diagnostics[index].decode,
+                        diagnostics[index].execute,
+                        trace_disasm ? " " : "",
+                        index == diag_index ? disasm_text : "");
+
+                }
+            }
+#endif
+            diag_index++;
+            if (diag_index >= diagnostic_size) { // Wrap the diagnostic buffer; its size is even so the F0/F1 pairs stay aligned
+                diag_index = 0;
+            }
+
+
+            // The bubble after a taken branch executes nothing and leaves last_executed_address as it was
+            if (breakpoint_set && !skip_update_last_executed_address && last_executed_address == breakpoint_address) {
+                program_running = FALSE; // Stop the program
+            }
+        }
+        else {
+            e_bubble = false;
+        }
+    }
+    // printf("End PC: %04x Clk: %d\n\n", PC, cpu_clock);
+    // previously increment cpu_clock here
+}
@@ -0,0 +1,547 @@
+/**
+ * @file cpu_fused.c
+ * @brief Fused fetch/decode/execute loop used by continuous runs.
+ * @details CPU() passes every stage through globals (regfile, psw, IR, global_inst_operands),
+ *          so the compiler reloads them after each store. CPU_fused() runs whole instruction
+ *          slots (one even and one odd clock tick) with R0-R7, the PSW flags and the pipeline
+ *          registers held in locals, and writes them back only when it returns: at the end of
+ *          the batch, on a breakpoint, or before handing an instruction to CPU(). The stage
+ *          order and the behaviour of every handler match CPU(), so both can be mixed freely.
+ */
+
+#include "Emulator.h"
+
+#define FUSED_NOP_ADD 0xFE // ADD with R7 as destination, which D0 turns into a NOP
+#define FUSED_SLOW 0xFF    // Encodings left to CPU(): D0 reports them or leaves them without a type
+
+static unsigned char fused_type[MEM_SIZE]; // enum instruct_table value for every encoding
+static int fused_table_ready = FALSE;
+
+/* update_psw() with its carry and overflow tables written out as logic */
+#define FUSED_PSW(src, dst, res, msb) do {                                      \
+    unsigned int mss_ = ((unsigned short)(src) >> (msb)) & 1;                   \
+    unsigned int msd_ = ((unsigned short)(dst) >> (msb)) & 1;                   \
+    unsigned int msr_ = ((unsigned short)(res) >> (msb)) & 1;                   \
+    c = (mss_ & msd_) | ((mss_ | msd_) & !msr_);                                \
+    z = ((unsigned short)(res) & ((msb) == 7 ? BYTE_MASK : 0xFFFF)) == 0;       \
+    n = msr_;                                                                   \
+    v = (mss_ == msd_) && (msr_ != mss_);                                       \
+} while (0)
+
+/* update_psw2() */
+#define FUSED_PSW2(res, msb) do {                                               \
+    n = ((res) >> (msb)) & 1;                                                   \
+    z = ((res) & ((msb) == 7 ? BYTE_MASK : 0xFFFF)) == 0;                       \
+} while (0)
+
+/**
+ * @brief Classify an encoding exactly as D0() does.
+ */
+static unsigned char fused_classify(unsigned short instruction) {
+    unsigned short mov_to_clrcc = MOV_TO_CLRCC(instruction);
+
+    switch (EXTRACT_2_BITS(instruction, 14)) {
+    case 0x02:
+        return LDR_EXEC;
+    case 0x03:
+        return STR_EXEC;
+    default:
+        break;
+    }
+
+    switch (FIRST_3_BITS(instruction)) {
+    case 0x00:
+        return BL_EXEC;
+    case 0x01:
+        return BEQ_BZ_EXEC + OTHER_BRANCH_CHECK(instruction);
+    case 0x03:
+        return MOVL_EXEC + MOVL_TO_MOVH_CHECK(instruction);
+    default:
+        break;
+    }
+
+    if (FIRST_4_BITS(instruction) == 0x04 && ADD_TO_BIS_CHECK(instruction) <= 0x0B) {
+        if (ADD_TO_BIS_CHECK(instruction) == 0x00 && DST(instruction) == 7) {
+            return FUSED_NOP_ADD;
+        }
+        return ADD_EXEC + ADD_TO_BIS_CHECK(instruction);
+    }
+    if (FIRST_4_BITS(instruction) == 0x04 && mov_to_clrcc == 0x18) {
+        return MOV_EXEC;
+    }
+    if (FIRST_4_BITS(instruction) == 0x04 && mov_to_clrcc == 0x19) {
+        return WB(instruction) ? FUSED_SLOW : SWAP_EXEC;
+    }
+    if (FIRST_4_BITS(instruction) == 0x04 && mov_to_clrcc == 0x1A) {
+        switch (EXTRACT_3_BITS(instruction, 3)) {
+        case 0x00: return SRA_EXEC;
+        case 0x01: return RRC_EXEC;
+        case 0x03: return WB(instruction) ? FUSED_SLOW : SWPB_EXEC;
+        case 0x04: return WB(instruction) ? FUSED_SLOW : SXT_EXEC;
+        default: return FUSED_SLOW;
+        }
+    }
+    if (FIRST_4_BITS(instruction) == 0x04 && mov_to_clrcc == 0x1B) {
+        switch (EXTRACT_2_BITS(instruction, 5)) {
+        case 0x01: return SETCC_EXEC;
+        case 0x02: return CLRCC_EXEC;
+        default: return FUSED_SLOW;
+        }
+    }
+    if (FIRST_4_BITS(instruction) == 0x05) {
+        switch (EXTRACT_3_BITS(instruction, 10)) {
+        case 0x06: return LD_EXEC;
+        case 0x07: return ST_EXEC;
+        default: return FUSED_SLOW;
+        }
+    }
+    return FUSED_SLOW;
+}
+
+/**
+ * @brief Build the encoding table. Called by CPU_fused(), and once before cores share it.
+ */
+void cpu_fused_init() {
+    unsigned int i;
+
+    if (!fused_table_ready) {
+        for (i = 0; i < MEM_SIZE; i++) {
+            fused_type[i] = fused_classify((unsigned short)i);
+        }
+        fused_table_ready = TRUE;
+    }
+}
+
+/**
+ * @brief Check whether nothing observes single loop iterations, so idle_skip() can be used.
+ * @details A timing model is allowed: idle_skip() measures an iteration through CPU(), stalls
+ *          included, and scales the timing counters with the iterations it skips.
+ * @return TRUE if the trace is off and the call graph profiler is not running.
+ */
+int idle_skip_allowed() {
+#ifdef DEBUG
+    if (trace_enabled) {
+        return FALSE;
+    }
+#endif
+    return !callgraph_enabled;
+}
+
+/**
+ * @brief Check whether nothing observes the per-tick globals, so CPU_fused() can be used.
+ * @return TRUE if idle_skip() can be used and no timing model is loaded.
+ */
+int cpu_fused_allowed() {
+    return idle_skip_allowed() && !timing_active;
+}
+
+/**
+ * @brief Run up to slots instruction slots, stopping early on a breakpoint.
+ * @details Bubbles, E1 and the delay slot after a PC write fall out of modelling the stages
+ *          in the same order as CPU(). Encodings D0() cannot decode are run through CPU().
+ */
+void CPU_fused(unsigned int slots) {
+    unsigned short reg[2 * NUM_REG_OR_CONS]; // R0-R7 followed by the constants, indexed by R/C and SRC
+    unsigned short imar, ir, inst, dmar, dmbr, dctrl, last_addr;
+    unsigned short src_val, dst_val, res, t;
+    unsigned char type, s, d, wb, src_b, dst_b, res_b;
+    unsigned int clock, c, z, n, v, slp, cur_pri, i;
+    int mem_offset, pending, taken, skip, executed, slow;
+    int bp_set = breakpoint_set;
+    unsigned short bp_addr = breakpoint_address;
+    int coverage = coverage_enabled;
+    unsigned int* hits = coverage_hits; // Thread-local, looked up once
+    unsigned int* dirty = dirty_pages[data_mem]; // Thread-local, looked up once
+    int heatmap = heatmap_enabled;
+    int profiling = profiler_active;
+
+    cpu_fused_init();
+    while (slots && program_running) {
+        // Let CPU() finish a partial slot: an odd tick, a bubble half-way or the first decode
+        while (program_running && ((cpu_clock & 1) || d_bubble != e_bubble || cpu_clock == 0)) {
+            CPU();
+        }
+        if (!program_running) {
+            break;
+        }
+        if (cex_count) { // Predicated slots of a CEX block go through CPU(), one at a time
+            CPU();
+            CPU();
+            slots--;
+            continue;
+        }
+        if (psw.slp) { // CPU() sleeps up to the next event; the slots slept through are used up
+            clock = cpu_clock;
+            CPU();
+            i = (cpu_clock - clock) / 2;
+            slots = i < slots ? slots - i : 0;
+            continue;
+        }
+
+        memcpy(reg, regfile, sizeof(reg));
+        c = psw.c; z = psw.z; n = psw.n; v = psw.v; slp = psw.slp; cur_pri = psw.current;
+        imar = IMAR; ir = IR; clock = cpu_clock;
+        inst = global_inst_operands.instruct_val;
+        type = (unsigned char)global_inst_operands.instruction_type;
+        dmar = DMAR; dmbr = DMBR; dctrl = DCTRL; mem_offset = offset;
+        pending = mem_exec_stage;
+        taken = d_bubble;
+        last_addr = last_executed_address;
+        skip = skip_update_last_executed_address;
+        executed = FALSE;
+        slow = FALSE;
+
+        for (; slots && !slp; slots--) { // SETCC with SLP ends the batch so CPU() can sleep
+            /* Even tick: F0, the pending E1, then D0 */
+            if (taken) { // Bubble after a taken branch, the fall-through word is dropped
+                taken = FALSE;
+                ir = NOP;
+            }
+            else if (fused_type[ir] >= FUSED_NOP_ADD || clock == 0) {
+                if (fused_type[ir] == FUSED_SLOW || clock == 0) {
+                    slow = TRUE;
+                    break;
+                }
+                ir = NOP;
+            }
+
+            imar = reg[7];
+            reg[7] += PC_INCREMENT;
+
+            if (pending) {
+                s = SRC_CON(inst);
+                d = DST(inst);
+                switch (type) {
+                case LD_EXEC:
+                case LDR_EXEC:
+                    dmbr = (dctrl & 1) ? dmemory.btmem[dmar] : dmemory.wdmem[dmar >> 1];
+                    reg[d] = dmbr;
+                    if (heatmap) {
+                        HEATMAP_COUNT(heatmap_reads, dmar, dctrl & 1, clock);
+                    }
+                    if (type == LD_EXEC && !EXTRACT_BIT(inst, 9)) {
+                        reg[s] += mem_offset;
+                    }
+                    break;
+                default: // ST and STR
+                    dmbr = reg[s];
+                    DIRTY_SET(dirty, dmar);
+                    if (heatmap) {
+                        HEATMAP_COUNT(heatmap_writes, dmar, dctrl & 1, clock);
+                    }
+                    if (dctrl & 1) {
+                        dmemory.btmem[dmar] = dmbr & BYTE_MASK;
+                    }
+                    else {
+                        dmemory.wdmem[dmar >> 1] = dmbr;
+                    }
+                    if (type == ST_EXEC && !EXTRACT_BIT(inst, 9)) {
+                        reg[d] += mem_offset;
+                    }
+                    break;
+                }
+                pending = FALSE;
+            }
+
+            inst = ir;
+            type = fused_type[inst];
+            clock++;
+
+            /* Odd tick: F1, then E0 */
+            ir = imemory.wdmem[imar >> 1];
+            executed = TRUE;
+
+            s = SRC_CON(inst);
+            d = DST(inst);
+            wb = WB(inst);
+            src_val = reg[(RC(inst) << 3) | s];
+            dst_val = reg[d];
+            src_b = (unsigned char)src_val;
+            dst_b = (unsigned char)dst_val;
+
+            skip = (type == MOV_EXEC && s == 0 && d == 0);
+            if (!skip) {
+                last_addr = imar - PC_INCREMENT;
+                if (coverage) {
+                    hits[last_addr >> 1]++;
+                }
+                if (profiling) { // What the SIGPROF handler samples, the rest waits for the end of the batch
+                    last_executed_address = last_addr;
+                    LR = reg[5];
+                    SP = reg[6];
+                }
+            }
+
+            switch (type) {
+            case BL_EXEC:
+                t = BL_OFFSET(inst);
+                if (t & 0x1000) {
+                    t |= 0xE000;
+                }
+                reg[5] = reg[7] - PC_INCREMENT;
+                reg[7] += (unsigned short)(t << 1);
+                reg[7] -= PC_INCREMENT;
+                taken = TRUE;
+                if (coverage) {
+                    coverage_branch(last_addr, reg[7], TRUE);
+                }
+                break;
+            case BEQ_BZ_EXEC: taken = z; goto branch;
+            case BNE_BNZ_EXEC: taken = !z; goto branch;
+            case BC_BHS_EXEC: taken = c; goto branch;
+            case BNC_BLO_EXEC: taken = !c; goto branch;
+            case BN_EXEC: taken = n; goto branch;
+            case BGE_EXEC: taken = (n == v); goto branch;
+            case BLT_EXEC: taken = (n != v); goto branch;
+            case BRA_EXEC:
+                taken = TRUE;
+            branch:
+                if (taken) {
+                    t = OTHER_BRANCHES_OFFSET(inst);
+                    if (t & 0x0200) {
+                        t |= 0xFC00;
+                    }
+                    reg[7] += (unsigned short)(t << 1);
+                    reg[7] -= PC_INCREMENT;
+                }
+                if (coverage) {
+                    coverage_branch(last_addr, taken ? reg[7] : (unsigned short)(last_addr + PC_INCREMENT), taken);
+                }
+                break;
+            case ADD_EXEC:
+                if (!wb) {
+                    res = dst_val + src_val;
+                    FUSED_PSW(src_val, dst_val, res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = dst_b + src_b;
+                    FUSED_PSW(src_b, dst_b, res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case ADDC_EXEC:
+                if (!wb) {
+                    res = dst_val + src_val + c;
+                    FUSED_PSW(src_val, dst_val, res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = dst_b + src_b + c;
+                    FUSED_PSW(src_b, dst_b, res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case SUB_EXEC:
+            case CMP_EXEC:
+                if (!wb) {
+                    t = ONES_COMPLEMENT(src_val);
+                    res = dst_val + t + 1;
+                    FUSED_PSW(t, dst_val, res, 15);
+                    if (type == SUB_EXEC) {
+                        reg[d] = res;
+                    }
+                }
+                else {
+                    t = ONES_COMPLEMENT(src_b);
+                    res_b = dst_b + t + 1;
+                    FUSED_PSW(t, dst_b, res_b, 7);
+                    if (type == SUB_EXEC) {
+                        reg[d] = res_b;
+                    }
+                }
+                break;
+            case SUBC_EXEC:
+                if (!wb) {
+                    t = ONES_COMPLEMENT(src_val);
+                    res = dst_val + t + c;
+                    FUSED_PSW(t, dst_val, res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    t = ONES_COMPLEMENT(src_b);
+                    res_b = dst_b + t + c;
+                    FUSED_PSW(t, dst_b, res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case DADD_EXEC:
+                t = (unsigned short)c;
+                res = bcd_add_swar(src_val, dst_val, wb, &t);
+                FUSED_PSW(src_val, res, res, wb ? 7 : 15);
+                c = t; // Decimal carry out, as in execute_DADD()
+                reg[d] = res;
+                break;
+            case XOR_EXEC:
+                if (!wb) {
+                    res = dst_val ^ src_val;
+                    FUSED_PSW2(res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = dst_b ^ src_b;
+                    FUSED_PSW2(res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case AND_EXEC:
+                if (!wb) {
+                    res = dst_val & src_val;
+                    FUSED_PSW2(res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = dst_b & src_b;
+                    FUSED_PSW2(res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case OR_EXEC:
+                if (!wb) {
+                    res = dst_val | src_val;
+                    FUSED_PSW2(res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = dst_b | src_b;
+                    FUSED_PSW2(res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case BIT_EXEC:
+                if (!wb) {
+                    z = src_val >= 16 || ((dst_val >> src_val) & 1) == clr_bit;
+                }
+                else {
+                    z = src_b >= 8 || ((dst_b >> src_b) & 1) == clr_bit;
+                }
+                break;
+            case BIC_EXEC:
+                if (!wb) {
+                    res = src_val < 16 ? dst_val & (unsigned short)~(1 << src_val) : dst_val;
+                    FUSED_PSW2(res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = src_b < 8 ? dst_b & (unsigned char)~(1 << src_b) : dst_b;
+                    FUSED_PSW2(res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case BIS_EXEC:
+                if (!wb) {
+                    res = src_val < 16 ? dst_val | (unsigned short)(1 << src_val) : dst_val;
+                    FUSED_PSW2(res, 15);
+                    reg[d] = res;
+                }
+                else {
+                    res_b = src_b < 8 ? dst_b | (unsigned char)(1 << src_b) : dst_b;
+                    FUSED_PSW2(res_b, 7);
+                    reg[d] = res_b;
+                }
+                break;
+            case MOV_EXEC:
+                reg[d] = wb ? src_b : src_val;
+                break;
+            case SWAP_EXEC:
+                reg[d] = reg[s];
+                reg[s] = dst_val;
+                break;
+            case SRA_EXEC:
+                reg[d] = wb ? ((dst_b >> 1) | (dst_b & 0x80)) : ((dst_val >> 1) | (dst_val & 0x8000));
+                break;
+            case RRC_EXEC:
+                if (!wb) {
+                    reg[d] = (unsigned short)((dst_val >> 1) | (c << 15));
+                    c = dst_val & 0x01;
+                }
+                else {
+                    reg[d] = (unsigned char)((dst_b >> 1) | (c << 7));
+                    c = dst_b & 0x01;
+                }
+                break;
+            case SWPB_EXEC:
+                reg[d] = (unsigned short)((dst_val << 8) | (dst_val >> 8));
+                break;
+            case SXT_EXEC:
+                reg[d] = (dst_b & 0x80) ? (0xFF00 | dst_b) : dst_b;
+                break;
+            case SETCC_EXEC:
+                c |= EXTRACT_BIT(inst, 0);
+                z |= EXTRACT_BIT(inst, 1);
+                n |= EXTRACT_BIT(inst, 2);
+                v |= EXTRACT_BIT(inst, 4);
+                slp = (cur_pri == 7) ? clr_bit : (slp | EXTRACT_BIT(inst, 3));
+                break;
+            case CLRCC_EXEC:
+                c &= !EXTRACT_BIT(inst, 0);
+                z &= !EXTRACT_BIT(inst, 1);
+                n &= !EXTRACT_BIT(inst, 2);
+                slp &= !EXTRACT_BIT(inst, 3);
+                v &= !EXTRACT_BIT(inst, 4);
+                break;
+            case MOVL_EXEC:
+                reg[d] = (dst_val & 0xFF00) | DATA(inst);
+                break;
+            case MOVLZ_EXEC:
+                reg[d] = DATA(inst);
+                break;
+            case MOVLS_EXEC:
+                reg[d] = 0xFF00 | DATA(inst);
+                break;
+            case MOVH_EXEC:
+                reg[d] = (unsigned short)(DATA(inst) << 8) | (dst_val & BYTE_MASK);
+                break;
+            case LD_EXEC:
+            case ST_EXEC:
+                mem_offset = (int)offset_table[EXTRACT_BIT(inst, 8)][EXTRACT_BIT(inst, 7)][wb];
+                i = (type == LD_EXEC) ? s : d; // Address register
+                dmar = reg[i];
+                if (EXTRACT_BIT(inst, 9)) { // Pre-increment or decrement
+                    dmar += mem_offset;
+                    reg[i] = dmar;
+                }
+                dctrl = (type == LD_EXEC ? READ_WORD : WRITE_WORD) | wb;
+                pending = TRUE;
+                break;
+            case LDR_EXEC:
+            case STR_EXEC:
+                dmar = reg[type == LDR_EXEC ? s : d] + (unsigned short)SIGN_EXTEND(RELATIVE_OFFSET(inst), 6);
+                dctrl = (type == LDR_EXEC ? READ_WORD : WRITE_WORD) | wb;
+                pending = TRUE;
+                break;
+            default:
+                break;
+            }
+            clock++;
+
+            if (bp_set && !skip && last_addr == bp_addr) {
+                program_running = FALSE;
+                slots--;
+                break;
+            }
+        }
+
+        /* Write the locals back to the globals CPU() and the menu work on */
+        memcpy(regfile[0], reg, sizeof(regfile[0]));
+        psw.c = c; psw.z = z; psw.n = n; psw.v = v; psw.slp = slp;
+        IMAR = imar; IMBR = IR = ir; ICTRL = READ_WORD;
+        cpu_clock = clock;
+        EA = DMAR = dmar; DMBR = dmbr; DCTRL = dctrl; offset = mem_offset;
+        mem_exec_stage = pending;
+        d_bubble = e_bubble = taken;
+        last_executed_address = last_addr;
+        skip_update_last_executed_address = skip;
+        if (executed) {
+            global_inst_operands = extract_inst_operands(inst);
+            global_inst_operands.instruction_type = (enum instruct_table)type;
+            global_inst_operands.branch_offset = (type == BL_EXEC) ? BL_OFFSET(inst) : OTHER_BRANCHES_OFFSET(inst);
+        }
+
+        if (slow) { // One slot through CPU(): its even and odd tick
+            CPU();
+            CPU();
+            slots--;
+        }
+    }
+}
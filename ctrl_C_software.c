@@ -1,47 +1,90 @@
-#include"Emulator.h"
-
-/************ Globals inside debugger ************/
-
-
-
-/*
- - volatile - do not cache or optimize, it can be changed elsewhere
- - sig_atomic_t - shared variable - handle possible race conditions
-*/
-
-volatile sig_atomic_t ctrl_c_fnd; /* T|F - indicates whether ^C detected */
-
-/************ Debugger support function ************/
-
-void sigint_hdlr()
-{
-	/*
-	- Invoked when SIGINT (control-C) is detected
-	- changes state of waiting_for_signal
-	- signal must be reinitialized
-	*/
-	ctrl_c_fnd = TRUE;
-	signal(SIGINT, (_crt_signal_t)sigint_hdlr); /* Reinitialize SIGINT */
-
-	// Clear input buffer
-	int ch;
-	while ((ch = getchar()) != '\n' && ch != EOF);
-}
-
-/************ Debugger startup software ************/
-
-/* Call signal() - bind sigint_hdlr to SIGINT */
-void init_signal() {
-
-	ctrl_c_fnd = FALSE;
-	signal(SIGINT, (_crt_signal_t)sigint_hdlr);
-
-}
-
-/************ Before calling the CPU emulator *************/
-void run_xm()
-{
-	/* Run the CPU */
-	ctrl_c_fnd = FALSE;
-	CPU();
-}
\ No newline at end of file
+#include"Emulator.h"
+
+/************ Globals inside debugger ************/
+
+
+
+/*
+ - volatile - do not cache or optimize, it can be changed elsewhere
+ - sig_atomic_t - shared variable - handle possible race conditions
+*/
+
+volatile sig_atomic_t ctrl_c_fnd; /* T|F - indicates whether ^C detected */
+
+/************ Debugger support function ************/
+
+void sigint_hdlr(int signum)
+{
+	/*
+	- Invoked when SIGINT (control-C) is detected
+	- only sets the flag, anything else is not async-signal-safe
+	- the run loop polls the flag between batches of cycles
+	*/
+	(void)signum;
+	ctrl_c_fnd = TRUE;
+}
+
+/************ Debugger startup software ************/
+
+/* Call signal() - bind sigint_hdlr to SIGINT */
+void init_signal() {
+	struct sigaction action;
+
+	ctrl_c_fnd = FALSE;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = sigint_hdlr;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART; /* ^C at a menu prompt must not abort the pending scanf() */
+	sigaction(SIGINT, &action, NULL);
+
+}
+
+/************ Before calling the CPU emulator *************/
+void run_xm()
+{
+	/* Run the CPU, then any device events that became due */
+	ctrl_c_fnd = FALSE;
+	CPU();
+	sched_dispatch();
+}
+
+/************ Continuous execution ('G' mode) *************/
+int run_xm_continuous()
+{
+	/*
+	- Runs the CPU in batches of at most RUN_BATCH half-cycles, each ending no later
+	  than the next scheduled device event, then dispatches the events that are due
+	- breakpoints stay exact: CPU() clears program_running on the cycle that hits one
+	- ^C is only polled between batches, so it is seen within RUN_BATCH half-cycles
+	- returns TRUE if execution was interrupted by ^C
+	- CPU_fused() runs the same cycles when nothing watches individual ticks; it works in
+	  whole instruction slots, so an event can be dispatched up to one slot late
+	- idle_skip() then jumps over the remaining iterations of an idle or countdown loop
+	*/
+	unsigned int cycles, target;
+
+	ctrl_c_fnd = FALSE; /* Discard a ^C typed at the menu */
+	while (program_running) {
+		cycles = sched_cycles_until_next(RUN_BATCH);
+		if (cycles != 0) {
+			if (cycles >= 2 && cpu_fused_allowed()) {
+				CPU_fused(cycles / 2); /* Two half-cycles per instruction slot */
+			}
+			else {
+				target = cpu_clock + cycles;
+				while (program_running && (int)(cpu_clock - target) < 0) {
+					CPU();
+				}
+			}
+		}
+		sched_dispatch();
+		if (idle_skip_allowed()) { /* Skip idle and countdown loops when nothing watches the iterations */
+			idle_skip();
+		}
+		if (ctrl_c_fnd) {
+			ctrl_c_fnd = FALSE;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
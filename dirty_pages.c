@@ -0,0 +1,143 @@
+/**
+ * @file dirty_pages.c
+ * @brief Dirty-page tracking of both memories, for fast resets and incremental checkpoints.
+ * @details Every write to a memory sets the bit of its 256-byte page in dirty_pages: the bus,
+ *          the fused loop, the loader, the memory editor, the debugger and the API all go
+ *          through MARK_DIRTY(). The bits are relative to the reset image, the state of the
+ *          machine right after its program was loaded, which reset_image_update() refreshes by
+ *          copying only the dirty pages and then clears the bits. reset_to_image() puts the
+ *          machine back by copying those pages the other way, and a checkpoint stores just
+ *          the pages dirty when it is taken, so both cost in proportion to what the program
+ *          wrote. A bit may be set for a page that is back to its image contents; it is never
+ *          clear for one that differs.
+ */
+
+#include "Emulator.h"
+
+XM_CORE unsigned int dirty_pages[2][DIRTY_WORDS]; // Indexed by instruction_mem / data_mem
+XM_CORE MachineState* reset_image = NULL;          // The resident machine's image, NULL if it has none
+
+/**
+ * @brief Mark the pages of length bytes at address in memory, clipped to the end of memory.
+ */
+void dirty_mark_range(int memory, unsigned int address, unsigned int length) {
+    unsigned int page;
+
+    if (length == 0 || address >= BTMEMSIZE) {
+        return;
+    }
+    if (length > BTMEMSIZE - address) {
+        length = BTMEMSIZE - address;
+    }
+    for (page = address >> DIRTY_PAGE_SHIFT; page <= (address + length - 1) >> DIRTY_PAGE_SHIFT; page++) {
+        dirty_pages[memory][page >> 5] |= 1u << (page & 31);
+    }
+}
+
+/**
+ * @brief Number of dirty pages in memory.
+ */
+unsigned int dirty_count(int memory) {
+    unsigned int word, count = 0;
+
+    for (word = 0; word < DIRTY_WORDS; word++) {
+        count += (unsigned int)__builtin_popcount(dirty_pages[memory][word]);
+    }
+    return count;
+}
+
+/**
+ * @brief Copy the pages whose bits are set in mask between two memories.
+ * @return Number of pages copied.
+ */
+static unsigned int copy_pages(union mem* to, const union mem* from, const unsigned int* mask) {
+    unsigned int word, bits, page, count = 0;
+
+    for (word = 0; word < DIRTY_WORDS; word++) {
+        for (bits = mask[word]; bits != 0; bits &= bits - 1) {
+            page = (word << 5) + (unsigned int)__builtin_ctz(bits);
+            memcpy(&to->btmem[page << DIRTY_PAGE_SHIFT], &from->btmem[page << DIRTY_PAGE_SHIFT], DIRTY_PAGE_SIZE);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Make the current state the reset image, after a program has been loaded.
+ * @details Only the dirty pages are copied into the image; the bits are then cleared.
+ */
+void reset_image_update() {
+    if (reset_image == NULL) {
+        return;
+    }
+    copy_pages(&reset_image->imem, &imemory, dirty_pages[instruction_mem]);
+    copy_pages(&reset_image->dmem, &dmemory, dirty_pages[data_mem]);
+    state_capture_registers(reset_image);
+    memset(dirty_pages, 0, sizeof(dirty_pages));
+}
+
+/**
+ * @brief Return the machine to its reset image: memories, registers, PSW, clock and pipeline.
+ * @return Number of pages copied, or -1 if the machine has no image.
+ */
+int reset_to_image() {
+    unsigned int pages;
+
+    if (reset_image == NULL) {
+        return -1;
+    }
+    pages = copy_pages(&imemory, &reset_image->imem, dirty_pages[instruction_mem]);
+    pages += copy_pages(&dmemory, &reset_image->dmem, dirty_pages[data_mem]);
+    state_restore_registers(reset_image);
+    memset(dirty_pages, 0, sizeof(dirty_pages));
+    return (int)pages;
+}
+
+/**
+ * @brief Capture the state into checkpoint, copying only the pages dirty since the reset image.
+ * @details The other pages of checkpoint are left as they were; checkpoint_restore() takes
+ *          them from the image, so a checkpoint is only meaningful with the image it was
+ *          taken against.
+ * @return Number of pages copied, or -1 if the machine has no image.
+ */
+int checkpoint_capture(MachineState* checkpoint) {
+    unsigned int pages;
+
+    if (reset_image == NULL) {
+        return -1;
+    }
+    pages = copy_pages(&checkpoint->imem, &imemory, dirty_pages[instruction_mem]);
+    pages += copy_pages(&checkpoint->dmem, &dmemory, dirty_pages[data_mem]);
+    state_capture_registers(checkpoint);
+    memcpy(checkpoint->dirty, dirty_pages, sizeof(checkpoint->dirty));
+    return (int)pages;
+}
+
+/**
+ * @brief Go back to a checkpoint taken by checkpoint_capture().
+ * @details Pages dirty in the checkpoint come from it; pages dirty only now come from the
+ *          reset image. Nothing else is copied.
+ * @return Number of pages copied, or -1 if the machine has no image.
+ */
+int checkpoint_restore(const MachineState* checkpoint) {
+    unsigned int stale[DIRTY_WORDS];
+    unsigned int word, pages;
+    int memory;
+
+    if (reset_image == NULL) {
+        return -1;
+    }
+    for (memory = instruction_mem, pages = 0; memory <= data_mem; memory++) {
+        for (word = 0; word < DIRTY_WORDS; word++) {
+            stale[word] = dirty_pages[memory][word] & ~checkpoint->dirty[memory][word];
+        }
+        pages += copy_pages(memory == data_mem ? &dmemory : &imemory,
+            memory == data_mem ? &reset_image->dmem : &reset_image->imem, stale);
+        pages += copy_pages(memory == data_mem ? &dmemory : &imemory,
+            memory == data_mem ? &checkpoint->dmem : &checkpoint->imem, checkpoint->dirty[memory]);
+    }
+    state_restore_registers(checkpoint);
+    memcpy(dirty_pages, checkpoint->dirty, sizeof(dirty_pages));
+    return (int)pages;
+}
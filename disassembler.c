@@ -0,0 +1,201 @@
+/**
+ * @file disassembler.c
+ * @brief XM-23 disassembler used by the trace and the memory display.
+ * @details Each 16-bit encoding is disassembled once and kept in a cache. Branches store
+ *          their offset instead of their target so that the cached text can be reused at
+ *          any address; the target is appended when the instruction is printed.
+ */
+
+#include "Emulator.h"
+
+typedef struct {
+    char text[DISASM_TEXT_LEN]; // Mnemonic and operands, without the branch target
+    short target_offset;        // Byte offset of the branch target from address + 2
+    unsigned char is_branch;
+    unsigned char valid;
+} DisasmEntry;
+
+static DisasmEntry disasm_cache[MEM_SIZE];
+
+static const char* branch_names[] = { "BEQ", "BNE", "BC", "BNC", "BN", "BGE", "BLT", "BRA" };
+static const char* alu_names[] = { "ADD", "ADDC", "SUB", "SUBC", "DADD", "CMP", "XOR", "AND", "OR", "BIT", "BIC", "BIS" };
+static const char* movl_names[] = { "MOVL", "MOVLZ", "MOVLS", "MOVH" };
+static const char* cex_names[] = { "EQ", "NE", "CS", "CC", "MI", "PL", "VS", "VC",
+                                   "HI", "LS", "GE", "LT", "GT", "LE", "TR", "FL" };
+static const char* const_names[] = { "#0", "#1", "#2", "#4", "#8", "#16", "#32", "#-1" };
+
+/**
+ * @brief Format the source operand, a register or a constant depending on R/C.
+ */
+static const char* src_operand(InstructionInfo* info, char* buf) {
+    if (info->r_c) {
+        return const_names[info->src_con];
+    }
+    sprintf(buf, "R%d", info->src_con);
+    return buf;
+}
+
+/**
+ * @brief Format the register operand of LD/ST with its pre/post increment or decrement.
+ */
+static void ld_st_address(InstructionInfo* info, unsigned char reg, char* buf) {
+    char sign = info->dec == info->inc ? 0 : (info->inc ? '+' : '-');
+
+    if (sign == 0) {
+        sprintf(buf, "R%d", reg);
+    }
+    else if (info->prpo) {
+        sprintf(buf, "%cR%d", sign, reg);
+    }
+    else {
+        sprintf(buf, "R%d%c", reg, sign);
+    }
+}
+
+/**
+ * @brief Disassemble one encoding into a cache entry.
+ */
+static void disasm_fill(unsigned short instruction, DisasmEntry* entry) {
+    InstructionInfo info = extract_inst_operands(instruction);
+    const char* size = info.w_b ? ".B" : ".W";
+    char operand[12];
+
+    entry->is_branch = FALSE;
+    entry->target_offset = 0;
+
+    if (EXTRACT_2_BITS(instruction, 14) == 0x02 || EXTRACT_2_BITS(instruction, 14) == 0x03) { // LDR and STR
+        short offset = (short)SIGN_EXTEND(info.relative_offset, 6);
+        if (EXTRACT_2_BITS(instruction, 14) == 0x02) {
+            sprintf(entry->text, "LDR%s R%d,#%d,R%d", size, info.src_con, offset, info.dst);
+        }
+        else {
+            sprintf(entry->text, "STR%s R%d,R%d,#%d", size, info.src_con, info.dst, offset);
+        }
+    }
+    else if (FIRST_3_BITS(instruction) == 0x00) { // BL
+        entry->is_branch = TRUE;
+        entry->target_offset = (short)(SIGN_EXTEND(BL_OFFSET(instruction), 12) * 2);
+        strcpy(entry->text, "BL");
+    }
+    else if (FIRST_3_BITS(instruction) == 0x01) { // BEQ to BRA
+        entry->is_branch = TRUE;
+        entry->target_offset = (short)(SIGN_EXTEND(OTHER_BRANCHES_OFFSET(instruction), 9) * 2);
+        strcpy(entry->text, branch_names[OTHER_BRANCH_CHECK(instruction)]);
+    }
+    else if (FIRST_3_BITS(instruction) == 0x03) { // MOVL to MOVH
+        sprintf(entry->text, "%s #0x%02X,R%d", movl_names[MOVL_TO_MOVH_CHECK(instruction)], info.data, info.dst);
+    }
+    else if (FIRST_4_BITS(instruction) == 0x04 && ADD_TO_BIS_CHECK(instruction) <= 0x0B) {
+        sprintf(entry->text, "%s%s %s,R%d", alu_names[ADD_TO_BIS_CHECK(instruction)], size, src_operand(&info, operand), info.dst);
+    }
+    else if (FIRST_4_BITS(instruction) == 0x04 && MOV_TO_CLRCC(instruction) == 0x18) {
+        if (instruction == NOP) {
+            strcpy(entry->text, "NOP");
+        }
+        else {
+            sprintf(entry->text, "MOV%s R%d,R%d", size, info.src_con, info.dst);
+        }
+    }
+    else if (FIRST_4_BITS(instruction) == 0x04 && MOV_TO_CLRCC(instruction) == 0x19 && info.w_b == 0) {
+        sprintf(entry->text, "SWAP R%d,R%d", info.src_con, info.dst);
+    }
+    else if (FIRST_4_BITS(instruction) == 0x04 && MOV_TO_CLRCC(instruction) == 0x1A) {
+        switch (EXTRACT_3_BITS(instruction, 3)) {
+        case 0x00: sprintf(entry->text, "SRA%s R%d", size, info.dst); break;
+        case 0x01: sprintf(entry->text, "RRC%s R%d", size, info.dst); break;
+        case 0x03: sprintf(entry->text, "SWPB R%d", info.dst); break;
+        case 0x04: sprintf(entry->text, "SXT R%d", info.dst); break;
+        default: sprintf(entry->text, ".WORD 0x%04X", instruction); break;
+        }
+        if (info.w_b && EXTRACT_3_BITS(instruction, 3) >= 0x03) { // SWPB and SXT have no byte form
+            sprintf(entry->text, ".WORD 0x%04X", instruction);
+        }
+    }
+    else if (FIRST_4_BITS(instruction) == 0x04 && MOV_TO_CLRCC(instruction) == 0x1B) {
+        switch (EXTRACT_2_BITS(instruction, 5)) {
+        case 0x00:
+            if (EXTRACT_BIT(instruction, 4)) {
+                sprintf(entry->text, "SVC #%d", instruction & 0x0F);
+            }
+            else {
+                sprintf(entry->text, "SETPRI #%d", instruction & 0x07);
+            }
+            break;
+        case 0x01:
+        case 0x02:
+            sprintf(entry->text, "%s %s%s%s%s%s", EXTRACT_2_BITS(instruction, 5) == 0x01 ? "SETCC" : "CLRCC",
+                info.setclr_bits.v ? "V" : "", info.setclr_bits.slp ? "S" : "",
+                info.setclr_bits.n ? "N" : "", info.setclr_bits.z ? "Z" : "", info.setclr_bits.c ? "C" : "");
+            break;
+        default:
+            sprintf(entry->text, ".WORD 0x%04X", instruction);
+            break;
+        }
+    }
+    else if (FIRST_4_BITS(instruction) == 0x05 && EXTRACT_3_BITS(instruction, 10) == 0x04) { // CEX
+        sprintf(entry->text, "CEX %s,#%d,#%d", cex_names[(instruction >> 6) & 0x0F], EXTRACT_3_BITS(instruction, 3), EXTRACT_3_BITS(instruction, 0));
+    }
+    else if (FIRST_4_BITS(instruction) == 0x05 && EXTRACT_3_BITS(instruction, 10) == 0x06) { // LD
+        ld_st_address(&info, info.src_con, operand);
+        sprintf(entry->text, "LD%s %s,R%d", size, operand, info.dst);
+    }
+    else if (FIRST_4_BITS(instruction) == 0x05 && EXTRACT_3_BITS(instruction, 10) == 0x07) { // ST
+        ld_st_address(&info, info.dst, operand);
+        sprintf(entry->text, "ST%s R%d,%s", size, info.src_con, operand);
+    }
+    else {
+        sprintf(entry->text, ".WORD 0x%04X", instruction);
+    }
+
+    entry->valid = TRUE;
+}
+
+/**
+ * @brief Disassemble an instruction located at address.
+ * @param instruction The 16-bit encoding.
+ * @param address Address of the instruction, used for branch targets.
+ * @param buf Caller buffer of DISASM_BUF_LEN bytes, only written for branches.
+ * @return The disassembled text.
+ */
+const char* disassemble(unsigned short instruction, unsigned short address, char* buf) {
+    DisasmEntry* entry = &disasm_cache[instruction];
+
+    if (!entry->valid) {
+        disasm_fill(instruction, entry);
+    }
+    if (!entry->is_branch) {
+        return entry->text;
+    }
+
+    sprintf(buf, "%s 0x%04X", entry->text, (unsigned short)(address + PC_INCREMENT + entry->target_offset));
+    return buf;
+}
+
+/**
+ * @brief Display a region of instruction memory as disassembled instructions.
+ */
+void displayDisassembly() {
+    unsigned short memStart, memEnd;
+    unsigned int address;
+    char buf[DISASM_BUF_LEN];
+    int ch;
+
+    printf("Enter start and end address in this format (start end: 1000 2000): ");
+    while (scanf("%4hx %4hx", &memStart, &memEnd) != 2) {
+        if (feof(stdin)) {
+            return;
+        }
+        while ((ch = getchar()) != '\n' && ch != EOF); // Consume invalid input
+        printf("Invalid input. Please enter two hexadecimal addresses: ");
+    }
+
+    printf("\n========= Disassembly Display =========\n");
+
+    for (address = memStart & ~1u; address < memEnd; address += PC_INCREMENT) {
+        unsigned short instruction = imemory.wdmem[address >> 1];
+        printf("%04x: %04x  %s%s\n", address, instruction, disassemble(instruction, (unsigned short)address, buf),
+            (breakpoint_set && address == breakpoint_address) ? "  <-- breakpoint" : "");
+    }
+
+    printf("\n\n");
+}
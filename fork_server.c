@@ -0,0 +1,297 @@
+/**
+ * @file fork_server.c
+ * @brief Fork server: load once, then run each request in a forked copy of the loaded machine.
+ * @details xm23_fork_server() reads one request per line. For each one it forks a child,
+ *          which inherits the loaded memories copy-on-write, so nothing is parsed or loaded
+ *          again. The child applies the request's patch, runs, and writes a ForkResult to a
+ *          pipe before exiting. The server turns that result into one reply line. The
+ *          server's own machine never runs, so every request starts from the state as it
+ *          was loaded. A request is
+ *              <cycles> [D<addr>:<hex bytes>]... [R<n>:<hex value>]... [O<addr>:<hex length>]...
+ *          where D patches data memory, R sets a register and O asks for data memory bytes
+ *          in the reply. A cycle count of 0 runs without a limit; a line that does not start
+ *          with a count, or is longer than FORK_REQUEST_LEN - 1 characters, is an error, and
+ *          blank lines are skipped. The reply is
+ *              <stop> <last address> <clock> <R0>...<R7> <PSW> [O<addr>:<hex bytes>]...
+ *          with stop one of cycles, breakpoint, halted, interrupted or error, or
+ *          "crashed <status>" if the child died without a result, or "timeout" if it was still
+ *          running after FORK_TIMEOUT seconds and was killed. "ready" is written once
+ *          before the first request is read. Output from the children goes to /dev/null.
+ */
+
+#include "Emulator.h"
+#include "xm23.h"
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define FORK_REQUEST_LEN 8192 // Longest request line
+#define FORK_MAX_ITEMS 64     // D, R or O items of each kind in one request
+#define FORK_MAX_OUTPUT 4096  // Data memory bytes one reply can carry
+#define FORK_TIMEOUT 10       // Seconds a child may run, so a program that never stops cannot block the server
+
+typedef struct {
+    unsigned short address; // Register number for R
+    unsigned short length;  // Value for R
+} ForkItem;
+
+typedef struct {
+    unsigned int cycles;
+    ForkItem patches[FORK_MAX_ITEMS];
+    ForkItem regs[FORK_MAX_ITEMS];
+    ForkItem outputs[FORK_MAX_ITEMS];
+    int patch_count, reg_count, output_count;
+    unsigned char patch_bytes[FORK_REQUEST_LEN / 2]; // Bytes of the D items, one after the other
+} ForkRequest;
+
+typedef struct {
+    int stop; // enum xm23_stop
+    unsigned int clock;
+    unsigned short last_address;
+    unsigned short regs[NUM_REG_OR_CONS];
+    unsigned short psw;
+    unsigned char output[FORK_MAX_OUTPUT]; // The O ranges, one after the other
+} ForkResult;
+
+static const char* stop_names[] = { "cycles", "breakpoint", "halted", "interrupted", "error" };
+
+/**
+ * @brief Parse hex digit pairs into bytes.
+ * @return Number of bytes, or -1 if the text is not whole pairs of hex digits.
+ */
+static int parse_hex_bytes(const char* text, unsigned char* bytes, int max_bytes) {
+    int count = 0;
+    unsigned int value;
+
+    while (text[0] != '\0') {
+        if (!isxdigit((unsigned char)text[0]) || !isxdigit((unsigned char)text[1]) || count == max_bytes ||
+            sscanf(text, "%2x", &value) != 1) {
+            return -1;
+        }
+        bytes[count++] = (unsigned char)value;
+        text += 2;
+    }
+    return count;
+}
+
+/**
+ * @brief Parse a request line.
+ * @return FALSE with the reply line in error if it is malformed.
+ */
+static int fork_parse(char* line, ForkRequest* request, char* error) {
+    char* item;
+    char* value;
+    char* end;
+    unsigned long address, number;
+    int count, bytes_used = 0, output_total = 0;
+
+    request->cycles = (unsigned int)strtoul(line, &end, 0);
+    if (end == line) { // 0 means no limit, so a missing count must not read as one
+        strcpy(error, "error missing cycle count");
+        return FALSE;
+    }
+    line = end;
+    request->patch_count = request->reg_count = request->output_count = 0;
+    for (item = strtok(line, " \t\r\n"); item != NULL; item = strtok(NULL, " \t\r\n")) {
+        value = strchr(item, ':');
+        if (value == NULL) {
+            sprintf(error, "error missing ':' in %.32s", item);
+            return FALSE;
+        }
+        *value++ = '\0';
+        address = strtoul(&item[1], NULL, 16);
+        switch (item[0]) {
+        case 'D':
+            count = parse_hex_bytes(value, &request->patch_bytes[bytes_used], FORK_REQUEST_LEN / 2 - bytes_used);
+            if (address >= BTMEMSIZE || count < 0 || request->patch_count == FORK_MAX_ITEMS) {
+                sprintf(error, "error bad data patch at %.8s", &item[1]);
+                return FALSE;
+            }
+            request->patches[request->patch_count].address = (unsigned short)address;
+            request->patches[request->patch_count].length = (unsigned short)count;
+            request->patch_count++;
+            bytes_used += count;
+            break;
+        case 'R':
+            if (address >= NUM_REG_OR_CONS || request->reg_count == FORK_MAX_ITEMS) {
+                sprintf(error, "error no register R%.8s", &item[1]);
+                return FALSE;
+            }
+            request->regs[request->reg_count].address = (unsigned short)address;
+            request->regs[request->reg_count].length = (unsigned short)strtoul(value, NULL, 16); // The value
+            request->reg_count++;
+            break;
+        case 'O':
+            number = strtoul(value, NULL, 16);
+            if (address >= BTMEMSIZE || request->output_count == FORK_MAX_ITEMS ||
+                output_total + number > FORK_MAX_OUTPUT) {
+                sprintf(error, "error at most %d output bytes in %d ranges", FORK_MAX_OUTPUT, FORK_MAX_ITEMS);
+                return FALSE;
+            }
+            request->outputs[request->output_count].address = (unsigned short)address;
+            request->outputs[request->output_count].length = (unsigned short)number;
+            request->output_count++;
+            output_total += (int)number;
+            break;
+        default:
+            sprintf(error, "error unknown item %c", item[0]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Body of the child: patch, run, send the result, exit.
+ */
+static void fork_child(xm23_machine* machine, const ForkRequest* request, int result_fd, int null_fd) {
+    static ForkResult result;
+    xm23_counters counters;
+    int n, used = 0;
+
+    if (dup2(null_fd, STDOUT_FILENO) < 0) {
+        _exit(2);
+    }
+    alarm(FORK_TIMEOUT); // SIGALRM ends the child, the server replies "timeout"
+    for (n = 0; n < request->patch_count; n++) {
+        xm23_write_memory(machine, XM23_DATA_MEMORY, request->patches[n].address, &request->patch_bytes[used],
+            request->patches[n].length);
+        used += request->patches[n].length;
+    }
+    for (n = 0; n < request->reg_count; n++) {
+        xm23_set_register(machine, request->regs[n].address, request->regs[n].length);
+    }
+
+    result.stop = xm23_run(machine, request->cycles);
+    xm23_get_counters(machine, &counters);
+    result.clock = counters.cycles;
+    result.last_address = counters.last_address;
+    for (n = 0; n < NUM_REG_OR_CONS; n++) {
+        result.regs[n] = xm23_get_register(machine, n);
+    }
+    result.psw = xm23_get_psw(machine);
+    for (n = 0, used = 0; n < request->output_count; n++) {
+        used += (int)xm23_read_memory(machine, XM23_DATA_MEMORY, request->outputs[n].address, &result.output[used],
+            request->outputs[n].length);
+    }
+
+    _exit(write(result_fd, &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+}
+
+/**
+ * @brief Read a whole result from the pipe.
+ * @return FALSE if the child closed it early.
+ */
+static int fork_read_result(int fd, ForkResult* result) {
+    size_t got = 0;
+    ssize_t n;
+
+    while (got < sizeof(*result)) {
+        n = read(fd, (char*)result + got, sizeof(*result) - got);
+        if (n <= 0) {
+            return FALSE;
+        }
+        got += (size_t)n;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Write the reply line for a result.
+ */
+static void fork_reply(FILE* out, const ForkResult* result, const ForkRequest* request) {
+    int n, byte, used = 0;
+
+    fprintf(out, "%s %04X %u", stop_names[result->stop], result->last_address, result->clock);
+    for (n = 0; n < NUM_REG_OR_CONS; n++) {
+        fprintf(out, " %04X", result->regs[n]);
+    }
+    fprintf(out, " %04X", result->psw);
+    for (n = 0; n < request->output_count; n++) {
+        fprintf(out, " O%04X:", request->outputs[n].address);
+        for (byte = 0; byte < request->outputs[n].length && request->outputs[n].address + byte < BTMEMSIZE; byte++) {
+            fprintf(out, "%02X", result->output[used++]);
+        }
+    }
+    fputc('\n', out);
+}
+
+/**
+ * @brief Serve run requests until the input ends.
+ * @param machine The loaded machine every request starts from; it is never run itself.
+ * @param in_fd Requests, one per line.
+ * @param out_fd Replies, one line per request.
+ * @return Number of requests served, or -1 if the streams could not be set up.
+ */
+int xm23_fork_server(xm23_machine* machine, int in_fd, int out_fd) {
+    static char line[FORK_REQUEST_LEN];
+    static ForkRequest request;
+    static ForkResult result;
+    char error[BUFFER_LEN];
+    FILE* in = fdopen(in_fd, "r");
+    FILE* out = fdopen(out_fd, "w");
+    int pipe_fds[2];
+    int null_fd = open("/dev/null", O_WRONLY); // Opened once, each child only redirects to it
+    int served = 0, status, complete, ch;
+    pid_t child;
+
+    if (in == NULL || out == NULL || null_fd < 0) {
+        return -1;
+    }
+    xm23_get_psw(machine); // Make the machine resident before the first fork
+    fflush(stdout);        // The loader's messages come before "ready"
+    fprintf(out, "ready\n");
+    fflush(out);
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (strchr(line, '\n') == NULL && (ch = fgetc(in)) != '\n' && ch != EOF) { // fgets() split the line, drop the rest
+            while ((ch = fgetc(in)) != '\n' && ch != EOF);
+            fprintf(out, "error request longer than %d characters\n", FORK_REQUEST_LEN - 1);
+            fflush(out);
+            continue;
+        }
+        if (line[strspn(line, " \t\r\n")] == '\0') { // Blank lines get no reply
+            continue;
+        }
+        if (!fork_parse(line, &request, error)) { // Parsed before the fork, the child inherits it
+            fprintf(out, "%s\n", error);
+            fflush(out);
+            continue;
+        }
+
+        fflush(stdout); // Nothing buffered may be written twice
+        if (pipe(pipe_fds) != 0) {
+            fprintf(out, "error cannot open a pipe\n");
+            fflush(out);
+            continue;
+        }
+        child = fork();
+        if (child < 0) {
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+            fprintf(out, "error cannot fork\n");
+            fflush(out);
+            continue;
+        }
+        if (child == 0) {
+            close(pipe_fds[0]);
+            fork_child(machine, &request, pipe_fds[1], null_fd);
+        }
+        close(pipe_fds[1]);
+        complete = fork_read_result(pipe_fds[0], &result);
+        close(pipe_fds[0]);
+        waitpid(child, &status, 0);
+        if (complete) {
+            fork_reply(out, &result, &request);
+        }
+        else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+            fprintf(out, "timeout\n");
+        }
+        else {
+            fprintf(out, "crashed %d\n", status);
+        }
+        fflush(out);
+        served++;
+    }
+    close(null_fd);
+    return served;
+}
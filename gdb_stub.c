@@ -0,0 +1,722 @@
+/**
+ * @file gdb_stub.c
+ * @brief GDB remote serial protocol server for driving the emulator from a debugger front-end.
+ * @details gdb_serve() listens on a local TCP port or a Unix socket, accepts one debugger and
+ *          answers its packets until it detaches. The register block (g/G) is R0-R7 followed
+ *          by the PSW, each 16 bits little-endian; R7 is the PC. The two memories share one
+ *          address space: instruction memory at 0x00000-0x0FFFF and data memory at
+ *          0x10000-0x1FFFF. Memory moves as binary (x/X) or hex (m/M), and a single packet
+ *          can carry a whole 64 KB memory. R7 reads as the address of the next instruction to
+ *          execute, not the prefetch PC, and writing it jumps there. Z0/Z1 breakpoints stop
+ *          the run before the instruction at their address executes, so the stop PC is the
+ *          breakpoint address; Z2 write watchpoints stop it after a store into their range
+ *          has reached memory. vCont (and c/s) continue or step one instruction. A ^C (0x03) from the debugger is
+ *          polled between batches of cycles, as the menu polls SIGINT.
+ */
+
+#include "Emulator.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define GDB_BUFFER (2 * BTMEMSIZE + 64)  // A whole memory, every byte escaped
+#define GDB_DATA_BASE 0x10000u           // Data memory in the debugger's address space
+#define GDB_REGISTERS (NUM_REG_OR_CONS + 1) // R0-R7 and the PSW
+#define GDB_INTERRUPT 0x03
+#define GDB_ESCAPE 0x7D
+
+static int client = -1;
+static int unix_socket;         // Listening on a Unix socket path rather than a TCP port
+static int no_ack = FALSE;      // Set by QStartNoAckMode
+static char packet[GDB_BUFFER];
+static char reply[GDB_BUFFER];
+static unsigned char in_buffer[BUFFER_LEN];
+static int in_length, in_position;
+
+static unsigned short breakpoints[GDB_MAX_BREAKPOINTS];
+static int breakpoint_count = 0;
+static struct {
+    unsigned short start;
+    unsigned short length;
+} watchpoints[GDB_MAX_WATCHPOINTS];
+static int watchpoint_count = 0;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief Next byte from the debugger, blocking.
+ * @return The byte, or -1 once the connection is closed.
+ */
+static int gdb_getc() {
+    if (in_position == in_length) {
+        in_length = (int)recv(client, in_buffer, sizeof(in_buffer), 0);
+        in_position = 0;
+        if (in_length <= 0) {
+            in_length = 0;
+            return -1;
+        }
+    }
+    return in_buffer[in_position++];
+}
+
+/**
+ * @brief TRUE if the debugger sent ^C while the target was running.
+ * @details Other bytes cannot arrive while the target runs, as the debugger waits for the stop reply.
+ */
+static int gdb_interrupted() {
+    struct pollfd poll_client = { client, POLLIN, 0 };
+
+    if (in_position == in_length && poll(&poll_client, 1, 0) <= 0) {
+        return FALSE;
+    }
+    return gdb_getc() == GDB_INTERRUPT;
+}
+
+static int hex_value(int ch) {
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Send one packet, with $, # and the checksum added, until the debugger acknowledges it.
+ * @return FALSE if the connection is closed.
+ */
+static int gdb_send(const char* data, int length) {
+    static char frame[GDB_BUFFER + 4];
+    unsigned char checksum = 0;
+    int n, ack;
+
+    frame[0] = '$';
+    for (n = 0; n < length; n++) {
+        checksum += (unsigned char)data[n];
+    }
+    memcpy(&frame[1], data, (size_t)length);
+    frame[length + 1] = '#';
+    frame[length + 2] = hex_digits[checksum >> 4];
+    frame[length + 3] = hex_digits[checksum & 0xF];
+
+    do {
+        if (send(client, frame, (size_t)length + 4, 0) != length + 4) {
+            return FALSE;
+        }
+        ack = no_ack ? '+' : gdb_getc();
+    } while (ack == '-');
+    return ack != -1;
+}
+
+static int gdb_send_string(const char* data) {
+    return gdb_send(data, (int)strlen(data));
+}
+
+/**
+ * @brief Read the next packet into packet[], acknowledging it.
+ * @return Its length (binary data stays escaped), or -1 once the connection is closed.
+ */
+static int gdb_receive() {
+    unsigned char checksum;
+    int ch, high, low, length;
+
+    while (1) {
+        do { // Acks and a stray ^C between packets are dropped
+            ch = gdb_getc();
+            if (ch == -1) {
+                return -1;
+            }
+        } while (ch != '$');
+
+        checksum = 0;
+        length = 0;
+        while ((ch = gdb_getc()) != '#') {
+            if (ch == -1) {
+                return -1;
+            }
+            if (length < GDB_BUFFER - 1) {
+                packet[length++] = (char)ch;
+            }
+            checksum += (unsigned char)ch;
+        }
+        high = hex_value(gdb_getc());
+        low = hex_value(gdb_getc());
+        packet[length] = '\0';
+
+        if (no_ack) {
+            return length;
+        }
+        if (high >= 0 && low >= 0 && ((high << 4) | low) == checksum) {
+            send(client, "+", 1, 0);
+            return length;
+        }
+        send(client, "-", 1, 0); // Ask for it again
+    }
+}
+
+/**
+ * @brief Byte at an address of the debugger's address space.
+ * @return NULL outside the two memories.
+ */
+static unsigned char* gdb_byte(unsigned long address) {
+    if (address < GDB_DATA_BASE) {
+        return &imemory.btmem[address];
+    }
+    if (address < GDB_DATA_BASE + BTMEMSIZE) {
+        return &dmemory.btmem[address - GDB_DATA_BASE];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parse "addr,length" at text, both hexadecimal.
+ * @return Pointer to the character after length, or NULL if malformed.
+ */
+static char* parse_range(char* text, unsigned long* address, unsigned long* length) {
+    char* end;
+
+    *address = strtoul(text, &end, 16);
+    if (end == text || *end != ',') {
+        return NULL;
+    }
+    text = end + 1;
+    *length = strtoul(text, &end, 16);
+    return end == text ? NULL : end;
+}
+
+/**
+ * @brief Reply to m (hex) or x (binary) with the bytes of a range.
+ */
+static int gdb_read_memory(char* args, int binary) {
+    unsigned long address, length, n;
+    unsigned char* byte;
+    int out = 0;
+
+    if (parse_range(args, &address, &length) == NULL) {
+        return gdb_send_string("E01");
+    }
+    if (length > BTMEMSIZE) {
+        length = BTMEMSIZE; // The debugger asks again for the rest
+    }
+    if (binary) {
+        reply[out++] = 'b';
+    }
+    for (n = 0; n < length && (byte = gdb_byte(address + n)) != NULL; n++) {
+        if (!binary) {
+            reply[out++] = hex_digits[*byte >> 4];
+            reply[out++] = hex_digits[*byte & 0xF];
+        }
+        else if (*byte == '#' || *byte == '$' || *byte == GDB_ESCAPE || *byte == '*') {
+            reply[out++] = GDB_ESCAPE;
+            reply[out++] = (char)(*byte ^ 0x20);
+        }
+        else {
+            reply[out++] = (char)*byte;
+        }
+    }
+    if (n == 0 && length != 0) {
+        return gdb_send_string("E01");
+    }
+    return gdb_send(reply, out);
+}
+
+/**
+ * @brief Handle M (hex) or X (binary) by writing the bytes that follow the colon.
+ */
+static int gdb_write_memory(char* args, int length, int binary) {
+    unsigned long address, count, n;
+    unsigned char* byte;
+    char* data = parse_range(args, &address, &count);
+    char* end = packet + length;
+    int high, low;
+
+    if (data == NULL || *data != ':') {
+        return gdb_send_string("E01");
+    }
+    data++;
+    for (n = 0; n < count; n++) {
+        byte = gdb_byte(address + n);
+        if (byte == NULL || data >= end) {
+            return gdb_send_string("E01");
+        }
+        MARK_DIRTY(address + n < GDB_DATA_BASE ? instruction_mem : data_mem, (address + n) & 0xFFFF);
+        if (binary) {
+            *byte = (unsigned char)*data++;
+            if (*byte == GDB_ESCAPE) {
+                *byte = (unsigned char)(*data++ ^ 0x20);
+            }
+        }
+        else {
+            high = hex_value(*data++);
+            low = hex_value(*data++);
+            if (high < 0 || low < 0) {
+                return gdb_send_string("E01");
+            }
+            *byte = (unsigned char)((high << 4) | low);
+        }
+    }
+    return gdb_send_string("OK");
+}
+
+/**
+ * @brief Address of the next instruction to execute, the PC the debugger sees.
+ * @details R7 runs ahead of execution: it is the prefetch address. On a slot boundary (even
+ *          clock) the instruction fetched by the last slot executes next, unless a taken
+ *          branch left a bubble, in which case the branch target does. Between D0 and E0 (odd
+ *          clock, where a watchpoint stops) the decoded instruction executes next, unless it
+ *          is the bubble.
+ */
+static unsigned short gdb_pc() {
+    if (cpu_clock == 0) {
+        return PC;
+    }
+    if (cpu_clock & 1) {
+        return e_bubble ? IMAR : (unsigned short)(IMAR - PC_INCREMENT);
+    }
+    return d_bubble ? PC : IMAR;
+}
+
+/**
+ * @brief Check whether the next slot only runs the bubble of a taken branch or of the start.
+ */
+static int gdb_bubble_next() {
+    return (cpu_clock & 1) ? e_bubble : (cpu_clock == 0 || d_bubble);
+}
+
+static unsigned short gdb_register(int n) {
+    unsigned short psw_word;
+
+    if (n == 7) {
+        return gdb_pc();
+    }
+    if (n < NUM_REG_OR_CONS) {
+        return regfile[0][n];
+    }
+    memcpy(&psw_word, &psw, sizeof(psw_word));
+    return psw_word;
+}
+
+static void gdb_set_register(int n, unsigned short value) {
+    if (n == 7) {
+        if (value != gdb_pc()) { // Jump there: drop the prefetched instruction as a taken branch does
+            PC = value;
+            d_bubble = e_bubble = true;
+        }
+    }
+    else if (n < NUM_REG_OR_CONS) {
+        regfile[0][n] = value;
+    }
+    else {
+        memcpy(&psw, &value, sizeof(value));
+    }
+}
+
+/**
+ * @brief Write a register as four hex digits, low byte first.
+ */
+static void put_register(char* out, unsigned short value) {
+    out[0] = hex_digits[(value >> 4) & 0xF];
+    out[1] = hex_digits[value & 0xF];
+    out[2] = hex_digits[(value >> 12) & 0xF];
+    out[3] = hex_digits[(value >> 8) & 0xF];
+}
+
+/**
+ * @brief Parse four hex digits, low byte first.
+ * @return The value, or -1 if malformed.
+ */
+static int get_register(const char* in) {
+    int digit[4], n;
+
+    for (n = 0; n < 4; n++) {
+        digit[n] = hex_value(in[n]);
+        if (digit[n] < 0) {
+            return -1;
+        }
+    }
+    return digit[2] << 12 | digit[3] << 8 | digit[0] << 4 | digit[1];
+}
+
+/**
+ * @brief Handle Z (insert) and z (remove) for breakpoints (types 0 and 1) and write watchpoints (type 2).
+ */
+static int gdb_breakpoint(char* args, int insert) {
+    unsigned long address, kind;
+    int type = args[0] - '0';
+    int n;
+
+    if (args[1] != ',' || parse_range(&args[2], &address, &kind) == NULL) {
+        return gdb_send_string("E01");
+    }
+    if (type == 0 || type == 1) {
+        if (address >= GDB_DATA_BASE) {
+            return gdb_send_string("E01");
+        }
+        for (n = 0; n < breakpoint_count && breakpoints[n] != address; n++);
+        if (insert && n == breakpoint_count) {
+            if (breakpoint_count == GDB_MAX_BREAKPOINTS) {
+                return gdb_send_string("E02");
+            }
+            breakpoints[breakpoint_count++] = (unsigned short)address;
+        }
+        else if (!insert && n < breakpoint_count) {
+            breakpoints[n] = breakpoints[--breakpoint_count];
+        }
+        return gdb_send_string("OK");
+    }
+    if (type == 2) {
+        if (address < GDB_DATA_BASE || address - GDB_DATA_BASE + kind > BTMEMSIZE || kind == 0) {
+            return gdb_send_string("E01");
+        }
+        address -= GDB_DATA_BASE;
+        for (n = 0; n < watchpoint_count &&
+            (watchpoints[n].start != address || watchpoints[n].length != kind); n++);
+        if (insert && n == watchpoint_count) {
+            if (watchpoint_count == GDB_MAX_WATCHPOINTS) {
+                return gdb_send_string("E02");
+            }
+            watchpoints[watchpoint_count].start = (unsigned short)address;
+            watchpoints[watchpoint_count++].length = (unsigned short)kind;
+        }
+        else if (!insert && n < watchpoint_count) {
+            watchpoints[n] = watchpoints[--watchpoint_count];
+        }
+        return gdb_send_string("OK");
+    }
+    return gdb_send_string(""); // Read and access watchpoints are not supported
+}
+
+/**
+ * @brief TRUE if the store now waiting for E1 writes into a watched range.
+ */
+static int gdb_store_watched(unsigned int* address) {
+    unsigned int first, last;
+    int n;
+
+    if (!mem_exec_stage || (global_inst_operands.instruction_type != ST_EXEC &&
+        global_inst_operands.instruction_type != STR_EXEC)) {
+        return FALSE;
+    }
+    first = (DCTRL == WRITE_BYTE) ? DMAR : (DMAR & ~1u);
+    last = (DCTRL == WRITE_BYTE) ? first : first + 1;
+    for (n = 0; n < watchpoint_count; n++) {
+        if (first < (unsigned int)watchpoints[n].start + watchpoints[n].length && last >= watchpoints[n].start) {
+            *address = GDB_DATA_BASE + (first > watchpoints[n].start ? first : watchpoints[n].start);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Execute one instruction through CPU(), checking the breakpoints and watchpoints.
+ * @details A bubble slot is run together with the instruction after it. A breakpoint stops
+ *          the run when the next instruction to execute is at its address, before that
+ *          instruction executes, as GDB expects.
+ * @return TRUE if one of them stopped the run; the stop reply is then in reply[].
+ */
+static int gdb_slot() {
+    unsigned int start;
+    unsigned int address;
+    int n, bubble;
+
+    do {
+        bubble = gdb_bubble_next();
+        start = cpu_clock;
+        while (program_running && cpu_clock - start < 2) {
+            CPU();
+            sched_dispatch();
+            if ((cpu_clock & 1) == 0 && cpu_clock != start && gdb_store_watched(&address)) {
+                while (program_running && mem_exec_stage) { // Let the store reach memory first
+                    CPU();
+                }
+                sprintf(reply, "T05watch:%x;", address);
+                return TRUE;
+            }
+        }
+    } while (bubble && program_running);
+    for (n = 0; n < breakpoint_count; n++) {
+        if (gdb_pc() == breakpoints[n]) {
+            strcpy(reply, "S05");
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Continue, or step one instruction, until something stops the target.
+ * @details Without breakpoints or watchpoints the run goes as fast as run_xm_continuous();
+ *          otherwise each instruction goes through gdb_slot(). A continue from a breakpoint
+ *          first executes the instruction there.
+ */
+static void gdb_run(int step) {
+    int fast = watchpoint_count == 0 && breakpoint_count == 0 && cpu_fused_allowed();
+    unsigned int cycles, target;
+    int slot;
+
+    program_running = TRUE;
+    breakpoint_set = FALSE;
+    breakpoint_address = INVALID;
+    strcpy(reply, "S05");
+    ctrl_c_fnd = FALSE;
+
+    if (step) {
+        gdb_slot();
+        return;
+    }
+    while (program_running) {
+        if (fast) {
+            cycles = sched_cycles_until_next(RUN_BATCH);
+            if (cycles >= 2) {
+                CPU_fused(cycles / 2);
+            }
+            else {
+                target = cpu_clock + cycles;
+                while (program_running && (int)(cpu_clock - target) < 0) {
+                    CPU();
+                }
+            }
+            sched_dispatch();
+            idle_skip();
+        }
+        else {
+            for (slot = 0; slot < RUN_BATCH / 2 && program_running; slot++) {
+                if (gdb_slot()) {
+                    return;
+                }
+            }
+        }
+        if (gdb_interrupted() || ctrl_c_fnd) {
+            ctrl_c_fnd = FALSE;
+            strcpy(reply, "S02");
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Answer the packets of one debugger until it detaches or kills the target.
+ */
+static void gdb_session() {
+    int length, n, value;
+    char* action;
+
+    while ((length = gdb_receive()) >= 0) {
+        switch (packet[0]) {
+        case '?':
+            gdb_send_string("S05");
+            break;
+        case 'g':
+            for (n = 0; n < GDB_REGISTERS; n++) {
+                put_register(&reply[4 * n], gdb_register(n));
+            }
+            gdb_send(reply, 4 * GDB_REGISTERS);
+            break;
+        case 'G':
+            for (n = 0; n < GDB_REGISTERS && 1 + 4 * n + 4 <= length; n++) {
+                value = get_register(&packet[1 + 4 * n]);
+                if (value < 0) {
+                    break;
+                }
+                gdb_set_register(n, (unsigned short)value);
+            }
+            gdb_send_string(n == GDB_REGISTERS ? "OK" : "E01");
+            break;
+        case 'p':
+            n = (int)strtol(&packet[1], NULL, 16);
+            if (n < 0 || n >= GDB_REGISTERS) {
+                gdb_send_string("E01");
+                break;
+            }
+            put_register(reply, gdb_register(n));
+            gdb_send(reply, 4);
+            break;
+        case 'P':
+            n = (int)strtol(&packet[1], &action, 16);
+            value = (*action == '=') ? get_register(action + 1) : -1;
+            if (n < 0 || n >= GDB_REGISTERS || value < 0) {
+                gdb_send_string("E01");
+                break;
+            }
+            gdb_set_register(n, (unsigned short)value);
+            gdb_send_string("OK");
+            break;
+        case 'm':
+        case 'x':
+            gdb_read_memory(&packet[1], packet[0] == 'x');
+            break;
+        case 'M':
+        case 'X':
+            gdb_write_memory(&packet[1], length, packet[0] == 'X');
+            break;
+        case 'Z':
+        case 'z':
+            gdb_breakpoint(&packet[1], packet[0] == 'Z');
+            break;
+        case 'c':
+        case 's':
+            gdb_run(packet[0] == 's');
+            gdb_send_string(reply);
+            break;
+        case 'v':
+            if (strcmp(packet, "vCont?") == 0) {
+                gdb_send_string("vCont;c;C;s;S");
+            }
+            else if (strncmp(packet, "vCont;", 6) == 0) {
+                action = &packet[6]; // One thread, so the first action applies
+                gdb_run(*action == 's' || *action == 'S');
+                gdb_send_string(reply);
+            }
+            else {
+                gdb_send_string("");
+            }
+            break;
+        case 'q':
+            if (strncmp(packet, "qSupported", 10) == 0) {
+                sprintf(reply, "PacketSize=%x;QStartNoAckMode+;binary-upload+;vContSupported+", GDB_BUFFER - 16);
+                gdb_send_string(reply);
+            }
+            else if (strcmp(packet, "qAttached") == 0) {
+                gdb_send_string("1");
+            }
+            else if (strcmp(packet, "qC") == 0) {
+                gdb_send_string("QC1");
+            }
+            else if (strcmp(packet, "qfThreadInfo") == 0) {
+                gdb_send_string("m1");
+            }
+            else if (strcmp(packet, "qsThreadInfo") == 0) {
+                gdb_send_string("l");
+            }
+            else {
+                gdb_send_string("");
+            }
+            break;
+        case 'Q':
+            if (strcmp(packet, "QStartNoAckMode") == 0) {
+                gdb_send_string("OK");
+                no_ack = TRUE;
+            }
+            else {
+                gdb_send_string("");
+            }
+            break;
+        case 'H':
+        case 'T':
+            gdb_send_string("OK"); // The only thread
+            break;
+        case 'D':
+            gdb_send_string("OK");
+            return;
+        case 'k':
+            return;
+        default:
+            gdb_send_string(""); // Not supported
+        }
+    }
+}
+
+/**
+ * @brief Open the listening socket: a TCP port on 127.0.0.1 if address is a number,
+ *        otherwise a Unix socket at that path.
+ * @return The socket, or -1 after printing why not.
+ */
+static int gdb_listen(const char* address) {
+    struct sockaddr_in tcp_address;
+    struct sockaddr_un unix_address;
+    char* end;
+    unsigned long port = strtoul(address, &end, 10);
+    int listener, reuse = 1;
+
+    unix_socket = (*address == '\0' || *end != '\0');
+    if (!unix_socket) {
+        if (port == 0 || port > 0xFFFF) {
+            printf("Invalid port %s\n", address);
+            return -1;
+        }
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&tcp_address, 0, sizeof(tcp_address));
+        tcp_address.sin_family = AF_INET;
+        tcp_address.sin_port = htons((unsigned short)port);
+        tcp_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listener >= 0) {
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (listener < 0 || bind(listener, (struct sockaddr*)&tcp_address, sizeof(tcp_address)) != 0) {
+            printf("Cannot listen on port %s\n", address);
+            if (listener >= 0) {
+                close(listener);
+            }
+            return -1;
+        }
+    }
+    else {
+        if (strlen(address) >= sizeof(unix_address.sun_path)) {
+            printf("Socket path too long: %s\n", address);
+            return -1;
+        }
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        memset(&unix_address, 0, sizeof(unix_address));
+        unix_address.sun_family = AF_UNIX;
+        strcpy(unix_address.sun_path, address);
+        unlink(address); // A socket left behind by an earlier session
+        if (listener < 0 || bind(listener, (struct sockaddr*)&unix_address, sizeof(unix_address)) != 0) {
+            printf("Cannot listen on %s\n", address);
+            if (listener >= 0) {
+                close(listener);
+            }
+            return -1;
+        }
+    }
+    if (listen(listener, 1) != 0) {
+        printf("Cannot listen on %s\n", address);
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+/**
+ * @brief Serve one debugger over the GDB remote serial protocol.
+ * @param address TCP port on 127.0.0.1, or the path of a Unix socket.
+ * @return TRUE once the debugger has detached, FALSE if the socket could not be opened.
+ */
+int gdb_serve(const char* address) {
+    int listener = gdb_listen(address);
+    int nodelay = 1;
+
+    if (listener < 0) {
+        return FALSE;
+    }
+    printf("Waiting for GDB on %s\n", address);
+    fflush(stdout);
+    client = accept(listener, NULL, NULL);
+    close(listener);
+    if (unix_socket) {
+        unlink(address);
+    }
+    if (client < 0) {
+        return FALSE;
+    }
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)); // Fails harmlessly on a Unix socket
+    printf("GDB connected\n");
+    fflush(stdout);
+
+    no_ack = FALSE;
+    in_length = in_position = 0;
+    gdb_session();
+
+    close(client);
+    client = -1;
+    printf("GDB detached at clock %u\n", cpu_clock);
+    return TRUE;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file idle_loop.c
+ * @brief Idle and countdown loop detection with a closed-form fast-forward.
+ * @details Guest images wait with a branch to itself (BRA $) or with a countdown
+ *          (SUB #k,Rn / BNE back to the SUB). Neither touches memory, and an iteration only
+ *          moves Rn by a constant, so the state after any number of iterations can be
+ *          worked out directly. Between batches of continuous running, idle_skip() looks
+ *          for such a loop around the last executed instruction, steps the CPU to the point
+ *          just after the loop branch was taken, runs one iteration through CPU() to
+ *          measure its length in clock ticks and check what it changed, and then applies
+ *          as many further iterations as it can in one step: all but the last one of a
+ *          countdown (the last one is run normally so the exit is exact), and never past
+ *          the next scheduled event. A pure self-loop with nothing pending can never end,
+ *          so it stops the run. Skipped iterations are added to the guest coverage counts, and
+ *          with a timing model to its counters; the measured period already has the stalls.
+ */
+
+#include "Emulator.h"
+
+#define IDLE_PROBE_TICKS 16       // Half-cycles allowed to reach the loop branch, and for one iteration
+#define BRANCH_TO_SELF 0x3FF      // BEQ-BRA offset of a branch to its own address
+#define BRANCH_TO_PREVIOUS 0x3FE  // BEQ-BRA offset of a branch to the word before it
+
+enum idle_loop_kind { IDLE_NONE, IDLE_SELF, IDLE_COUNTDOWN };
+
+/**
+ * @brief Check whether the loop branch of an idle or countdown loop sits at address.
+ */
+static enum idle_loop_kind idle_match(unsigned short address) {
+    unsigned short branch = imemory.wdmem[address >> 1];
+    unsigned short body = imemory.wdmem[(unsigned short)(address - PC_INCREMENT) >> 1];
+
+    if (FIRST_3_BITS(branch) != 0x01) {
+        return IDLE_NONE;
+    }
+    if (OTHER_BRANCH_CHECK(branch) == 0x07 && OTHER_BRANCHES_OFFSET(branch) == BRANCH_TO_SELF) { // BRA $
+        return IDLE_SELF;
+    }
+    // BNE back to a word-sized ADD or SUB of a constant, which sets Z for the branch
+    if (OTHER_BRANCH_CHECK(branch) == 0x01 && OTHER_BRANCHES_OFFSET(branch) == BRANCH_TO_PREVIOUS &&
+        FIRST_4_BITS(body) == 0x04 && (ADD_TO_BIS_CHECK(body) == 0x00 || ADD_TO_BIS_CHECK(body) == 0x02) &&
+        RC(body) && WB(body) == word && DST(body) != 7) {
+        return IDLE_COUNTDOWN;
+    }
+    return IDLE_NONE;
+}
+
+/**
+ * @brief Inverse of an odd number modulo 2^16.
+ */
+static unsigned short inverse_odd(unsigned short x) {
+    unsigned int inverse = x; // Correct to 3 bits, each Newton step doubles that
+
+    inverse *= 2 - x * inverse;
+    inverse *= 2 - x * inverse;
+    inverse *= 2 - x * inverse;
+    return (unsigned short)inverse;
+}
+
+/**
+ * @brief Iterations until value reaches 0 when step is subtracted each time.
+ * @return The smallest count >= 1, or 0 if value never reaches 0.
+ */
+static unsigned int countdown_iterations(unsigned short value, unsigned short step) {
+    unsigned int shift = 0;
+
+    if (step == 0) {
+        return 0;
+    }
+    while (!((step >> shift) & 1)) { // step * count = value (mod 2^16) needs value to share step's factors of 2
+        shift++;
+    }
+    if (value & ((1u << shift) - 1)) {
+        return 0;
+    }
+    return ((unsigned int)(value >> shift) * inverse_odd((unsigned short)(step >> shift))) & (0xFFFFu >> shift);
+}
+
+/**
+ * @brief Run CPU() until the branch at address has just been taken.
+ * @return TRUE once there, FALSE if the program went elsewhere or stopped.
+ */
+static int idle_run_to_branch(unsigned short address, int at_least_one) {
+    int tick;
+
+    for (tick = 0; tick < IDLE_PROBE_TICKS && program_running; tick++) {
+        if (!at_least_one && last_executed_address == address && d_bubble && !mem_exec_stage) {
+            return TRUE;
+        }
+        CPU();
+        at_least_one = FALSE;
+    }
+    return program_running && last_executed_address == address && d_bubble && !mem_exec_stage;
+}
+
+/**
+ * @brief Fast-forward through an idle or countdown loop at the last executed instruction.
+ * @return TRUE if iterations were skipped or the run was stopped.
+ */
+int idle_skip() {
+    unsigned short regs[NUM_REG_OR_CONS];
+    unsigned short branch = last_executed_address;
+    unsigned short inst, step, value;
+    unsigned int start, period, limit, skip, when, iterations;
+    TimingCounters counts; // Timing counters before the measured iteration
+    enum idle_loop_kind kind;
+    int reg, r;
+
+    // The probe runs CPU() for up to two IDLE_PROBE_TICKS, which must not pass the next event
+    if (!program_running || psw.slp || cex_count || branch == INVALID ||
+        sched_cycles_until_next(2 * IDLE_PROBE_TICKS) < 2 * IDLE_PROBE_TICKS) {
+        return FALSE;
+    }
+    kind = idle_match(branch);
+    if (kind == IDLE_NONE) { // The body of a countdown may have executed last
+        branch += PC_INCREMENT;
+        kind = idle_match(branch);
+    }
+    if (kind == IDLE_NONE || !idle_run_to_branch(branch, FALSE)) {
+        return FALSE;
+    }
+
+    // One iteration through CPU() gives its length and shows it only moved the counter
+    memcpy(regs, regfile[0], sizeof(regs));
+    start = cpu_clock;
+    counts = timing_counts;
+    if (!idle_run_to_branch(branch, TRUE)) {
+        return !program_running;
+    }
+    period = cpu_clock - start;
+    inst = imemory.wdmem[(unsigned short)(branch - PC_INCREMENT) >> 1];
+    reg = (kind == IDLE_COUNTDOWN) ? DST(inst) : -1;
+    for (r = 0; r < NUM_REG_OR_CONS; r++) {
+        if (r != reg && regs[r] != regfile[0][r]) {
+            return FALSE;
+        }
+    }
+    step = 0; // Amount taken off the counter each time
+    value = 0;
+    if (reg >= 0) {
+        step = (unsigned short)(regs[reg] - regfile[0][reg]);
+        value = regfile[0][reg];
+    }
+
+    limit = 0xFFFFFFFFu;
+    if (sched_next_event(&when)) {
+        if ((int)(when - cpu_clock) <= 0) {
+            return FALSE;
+        }
+        limit = (when - cpu_clock) / period; // Stop short of the event, it is dispatched as usual
+    }
+
+    iterations = (kind == IDLE_COUNTDOWN) ? countdown_iterations(value, step) : 0;
+    if (iterations == 0 && (kind == IDLE_SELF || step == 0) && limit == 0xFFFFFFFFu) {
+        printf("Idle loop at %04X with no pending events at clock %u\n", branch, cpu_clock);
+        program_running = FALSE;
+        return TRUE;
+    }
+    skip = (iterations != 0 && iterations - 1 < limit) ? iterations - 1 : limit;
+    if (skip == 0 || skip == 0xFFFFFFFFu) {
+        return FALSE;
+    }
+
+    cpu_clock += skip * period;
+    if (timing_active) { // The measured iteration's stalls are part of period, count them for each skipped one
+        timing_counts.instructions += skip * (timing_counts.instructions - counts.instructions);
+        timing_counts.fetch += skip * (timing_counts.fetch - counts.fetch);
+        timing_counts.data += skip * (timing_counts.data - counts.data);
+        timing_counts.execute += skip * (timing_counts.execute - counts.execute);
+        timing_counts.branch += skip * (timing_counts.branch - counts.branch);
+    }
+    if (coverage_enabled) { // The skipped iterations still count as executed
+        coverage_loop(kind == IDLE_COUNTDOWN ? (unsigned short)(branch - PC_INCREMENT) : branch, branch, skip);
+    }
+    if (reg >= 0) {
+        // The PSW is left as the last skipped ADD or SUB would have left it
+        value = (unsigned short)(value - skip * step);
+        if (ADD_TO_BIS_CHECK(inst) == 0x00) {
+            update_psw(regfile[1][SRC_CON(inst)], (unsigned short)(value + step), value, word);
+        }
+        else {
+            update_psw(ONES_COMPLEMENT(regfile[1][SRC_CON(inst)]), (unsigned short)(value + step), value, word);
+        }
+        regfile[0][reg] = value;
+    }
+    return TRUE;
+}
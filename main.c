@@ -1,228 +1,533 @@
-/**
- * @file main.c
- * @brief Main file for the emulator project.
- * @details This file contains the main function and user control functions for the emulator.
- * @date 2024-06-20
- * @author Temitope Onafalujo
- */
-
-#include "Emulator.h"
-
-union mem imemory = { 0 };
-union mem dmemory = { 0 };
-
-// Define the 2D array regfile
-unsigned short regfile[NUM_VALUES][NUM_REG_OR_CONS] = {
-    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000},
-    {0x0000, 0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0xFFFF}
-};
-
-int program_running = TRUE; // Global flag to indicate if the program is running
-unsigned short breakpoint_address = INVALID; // Initialized to an invalid address
-int breakpoint_set = FALSE; // Flag to indicate if a breakpoint has been set
-
-bool d_bubble = false;
-bool e_bubble = false;
-
-DiagnosticInfo diagnostics[diagnostic_index]; // Adjust size as needed
-int diag_index = 0;
-
-void user_control();
-void set_breakpoint();
-void display_memory_submenu();
-
-/**
- * @brief Main function to run the emulator.
- * @return int Return status code.
- */
-int main() {
-    int temp_ch;
-    int choice;
-
-    // Initialize signal handling
-    init_signal();
-
-    do {
-        printf("1. Load a new file\n");
-        printf("2. Start Emulation\n");
-        printf("3. Change memory value\n");
-        printf("4. Quit\n");
-        printf("Enter your choice: ");
-
-        if (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Please enter a number.\n\n");
-            while ((temp_ch = getchar()) != '\n' && temp_ch != EOF); // Clear the invalid input
-            continue; // Skip the rest of the loop and prompt the user again
-        }
-
-        switch (choice) {
-        case 1:
-            loadFile();
-            breakpoint_set = FALSE; // Reset the breakpoint flag when a new file is loaded
-            break;
-        case 2:
-            program_running = TRUE; // Reset the program_running flag
-            user_control();
-            break;
-        case 3:
-            change_memory_value();
-            break;
-        case 4:
-            printf("Exiting the program.\n");
-            program_running = 0;
-            break;
-        default:
-            printf("Invalid choice. Please try again.\n\n");
-        }
-    } while (choice != 4);
-
-    return 0;
-}
-
-/**
- * @brief User control function for the emulator.
- */
-void user_control() {
-    int ch;
-    char user_choice;
-    int menu_displayed = FALSE;
-    int single_step = FALSE;
-    int control_c_detected;
-
-    while (program_running) {
-        if (!menu_displayed) {
-            printf("\nWhat would you like to choose from the menu: \n");
-            printf("Press and enter I -> to Toggle Single Step Execution (currently %s)\n", single_step ? "Enabled" : "Disabled");
-            printf("Press and enter R -> to display Registers\n");
-            printf("Press and enter V -> to Change Register Value\n");
-            printf("Press and enter G -> to Go (execute continuously)\n");
-            printf("Press and enter B -> to Set Breakpoint\n");
-            printf("Press and enter P -> to Display PSW bits\n");
-            printf("Press and enter M -> to Display Memory\n");
-            printf("Press and enter Q -> to Quit\n");
-            printf("Enter option here ==> ");
-            menu_displayed = TRUE; // Set the flag to indicate that the menu has been displayed
-        }
-        else {
-            printf("\nEnter option (or ? to display the menu) ==> ");
-        }
-
-        (void)scanf(" %c", &user_choice);
-        while ((ch = getchar()) != '\n' && ch != EOF);
-
-        if (user_choice == '?') {
-            menu_displayed = FALSE; // Reset the flag to display the menu again
-            continue;
-        }
-
-        switch (user_choice) {
-        case 'I':
-        case 'i':
-            single_step = !single_step; // Toggle the single step flag
-            printf("Single step is now %s.\n", single_step ? "Enabled" : "Disabled");
-            break;
-        case 'R':
-        case 'r':
-            displayRegisterFile();
-            break;
-        case 'V':
-        case 'v':
-            change_register_value();
-            break;
-        case 'G':
-        case 'g':
-            control_c_detected = FALSE;
-            if (single_step) {
-                // Single-step mode: Execute two clock cycles (even and odd)
-                run_xm(); // First clock cycle (even)
-                if (program_running) {
-                    run_xm(); // Second clock cycle (odd)
-                }
-            }
-            else {
-                // Continuous mode: Execute until the program is no longer running or a breakpoint is reached or control-C is detected
-                while (program_running && (!breakpoint_set || last_executed_address != breakpoint_address)) {
-                    if (ctrl_c_fnd) { // Check if control-C was detected
-                        ctrl_c_fnd = FALSE;
-                        control_c_detected = TRUE;
-                        break; // Exit the while loop
-                    }
-                    run_xm();
-                }
-                if (!control_c_detected) {
-                    printf("End of instruction execution cycle or breakpoint reached.\n\n");
-                }
-                else {
-                    printf("Execution interrupted by Control-C\n\n");
-                }
-            }
-            program_running = TRUE; // Reset the flag to keep the menu active
-            break;
-        case 'B':
-        case 'b':
-            set_breakpoint();
-            break;
-        case 'P':
-        case 'p':
-            displayPswBits();
-            break;
-        case 'M':
-        case 'm':
-            display_memory_submenu();
-            break;
-        case 'Q':
-        case 'q':
-            program_running = FALSE;
-            break; // Exit the user control function to end the program
-        default:
-            printf("Invalid option. Try again.\n\n");
-        }
-    }
-}
-
-/**
- * @brief Submenu to display memory regions.
- */
-void display_memory_submenu() {
-    int ch;
-    char mem_choice;
-
-    printf("\nDisplay which memory? (I for Instruction, D for Data): ");
-    (void)scanf(" %c", &mem_choice);
-    while ((ch = getchar()) != '\n' && ch != EOF); //consume invalid input
-
-    switch (mem_choice) {
-    case 'I':
-    case 'i':
-        displayMemoryRegion(imemory.btmem);
-        break;
-    case 'D':
-    case 'd':
-        displayMemoryRegion(dmemory.btmem);
-        break;
-    default:
-        printf("Invalid option.\n\n");
-        break;
-    }
-}
-
-/**
- * @brief Set a breakpoint at a specified address.
- */
-void set_breakpoint() {
-    unsigned short address;
-    int ch;
-
-    printf("Enter the breakpoint address (in hexadecimal): ");
-    if (scanf("%4hx", &address) != 1) {
-        printf("Invalid address. Please enter a valid hexadecimal number.\n\n");
-        while ((ch = getchar()) != '\n' && ch != EOF); // Consume invalid input
-        return;
-    }
-
-    breakpoint_address = address;
-    breakpoint_set = TRUE; // Set the flag to indicate that a breakpoint has been set
-    printf("Breakpoint set at address: 0x%04X\n\n", breakpoint_address);
-
-    while ((ch = getchar()) != '\n' && ch != EOF); // Consume any leftover invalid input
-}
+/**
+ * @file main.c
+ * @brief Main file for the emulator project.
+ * @details This file contains the main function and user control functions for the emulator.
+ * @date 2024-06-20
+ * @author Temitope Onafalujo
+ */
+
+#include "Emulator.h"
+#include "xm23.h"
+#include <unistd.h> /* getopt */
+
+#define MAX_CLI_SEARCHES 16 // -x options accepted on one command line
+
+void user_control();
+void set_breakpoint();
+void display_memory_submenu();
+int run_batch(unsigned int lockstep_interval, const char* save_file, const char* compare_file,
+              const char** searches, int search_count);
+
+static int core_count = 1;                         // -m, cores run by -g
+static int multicore = FALSE;                      // -m or -M given
+static unsigned int core_quantum = MC_DEFAULT_QUANTUM; // -k, 0 for strict lockstep
+static unsigned int cycle_limit = 0;               // -t, 0 for no limit
+static const char* gdb_address = NULL;             // -r, serve GDB instead of the menu
+static int fork_server = FALSE;                    // -S, serve run requests instead of the menu
+static const char* image_file = "xm23";            // Last -f, the source named in coverage reports
+static const char* coverage_file = NULL;           // -V, coverage merged into this file after -g
+static const char* coverage_info = NULL;           // -L, lcov tracefile written from the coverage
+static const char* heatmap_file = NULL;            // -H, data memory heatmap exported after -g
+static const char* callgraph_file = NULL;          // -C, call-graph profile written after -g
+static const char* sweep_file = NULL;              // -W, timing grid run instead of the menu
+static int sweep_threads = 0;                      // -j, 0 for one per host CPU
+static xm23_machine* machine;                      // The emulator is driven through the libxm23 API
+
+/**
+ * @brief Scheduled by -t, ends the run when the cycle limit is reached.
+ */
+static void stop_at_cycle_limit(void* context, unsigned int when) {
+    (void)context;
+    (void)when;
+    program_running = FALSE;
+}
+
+/**
+ * @brief Print the command line options.
+ */
+static void usage(const char* program) {
+    printf("Usage: %s [-f file.xme] [-b breakpoint] [-g] [-q] [-l slots] [-s snapshot] [-c snapshot] [-x search] [-t cycles]\n"
+           "          [-m cores] [-M file.xme] [-k quantum] [-r port|path] [-S] [-V file.cov] [-L file.info]\n"
+           "          [-H heatmap.csv|heatmap.json] [-C prefix] [-y symbols.map]\n", program);
+    printf("  -f file.xme    Load the file before showing the menu\n");
+    printf("  -b breakpoint  Set a breakpoint (in hexadecimal)\n");
+    printf("  -g             Run to the breakpoint (or ^C), display the registers and exit\n");
+    printf("  -q             Disable the diagnostic trace\n");
+    printf("  -t cycles      Stop running once this many clock cycles have elapsed\n");
+    printf("  -l slots       With -g, check CPU() against the fused loop every slots instructions\n");
+    printf("  -s snapshot    With -g, save the machine state when the run stops\n");
+    printf("  -c snapshot    With -g, compare the machine state with a snapshot when the run stops\n");
+    printf("  -x search      With -g, search memory when the run stops (repeatable), as <i|d>[c]<b|w|u>:<hex>\n");
+    printf("                 e.g. dw:1234 (word), iu:4C98 (unaligned word), db:12 ?4 FF (bytes),\n");
+    printf("                 dcw:0005 (words that became 0005 during the run)\n");
+    printf("  -m cores       With -g, run the program on this many cores sharing the data memory\n");
+    printf("  -M file.xme    Add a core running its own image (repeatable), sharing the data memory\n");
+    printf("  -k quantum     Clock cycles between data memory exchanges of the cores, 0 for lockstep\n");
+    printf("  -r port|path   Serve the GDB remote protocol on a TCP port of 127.0.0.1 or a Unix socket\n");
+    printf("  -S             Fork server: run each request line from stdin in a copy of the loaded machine\n");
+    printf("  -V file.cov    With -g, count coverage and merge it into the file (created if needed)\n");
+    printf("  -L file.info   Write an lcov report of the coverage; without -g, of the -V file\n");
+    printf("  -H file        With -g, count data memory accesses per 16-byte line and export them (.csv or .json)\n");
+    printf("  -C prefix      With -g, profile the call graph into prefix.txt and prefix.folded\n");
+    printf("  -y map         Function names for the call graph, one \"address [type] name\" line each\n");
+    printf("  -T timing      Run with the wait states, latencies and branch penalties of a timing file\n");
+    printf("  -W grid        Run the loaded program under every timing model of a grid, print a table\n");
+    printf("  -j threads     Host threads running the -W grid, default one per CPU\n");
+}
+
+/**
+ * @brief Save and report coverage as asked by -V and -L.
+ * @return FALSE if a file could not be written.
+ */
+static int coverage_finish() {
+    if (coverage_file != NULL && !coverage_save(coverage_file)) {
+        return FALSE;
+    }
+    return coverage_info == NULL || coverage_report(coverage_info, image_file);
+}
+
+/**
+ * @brief Main function to run the emulator.
+ * @return int Return status code.
+ */
+int main(int argc, char* argv[]) {
+    int temp_ch;
+    int choice;
+    int opt;
+    int batch_mode = FALSE;
+    unsigned int lockstep_interval = 0;
+    const char* save_file = NULL;
+    const char* compare_file = NULL;
+    const char* searches[MAX_CLI_SEARCHES];
+    int search_count = 0;
+
+    machine = xm23_create();
+    if (machine == NULL) {
+        printf("Out of memory for the machine\n");
+        return 1;
+    }
+
+    while ((opt = getopt(argc, argv, "f:b:gqt:l:s:c:x:m:M:k:r:SV:L:H:C:y:T:W:j:")) != -1) {
+        switch (opt) {
+        case 'f':
+            if (!xm23_load_file(machine, optarg)) {
+                return 1;
+            }
+            image_file = optarg;
+            break;
+        case 'b':
+            xm23_set_breakpoint(machine, (unsigned short)strtoul(optarg, NULL, 16));
+            break;
+        case 'g':
+            batch_mode = TRUE;
+            break;
+        case 'q':
+            xm23_set_trace(FALSE);
+            break;
+        case 't':
+            cycle_limit = (unsigned int)strtoul(optarg, NULL, 0);
+            sched_post(cycle_limit, stop_at_cycle_limit, NULL);
+            break;
+        case 'l':
+            lockstep_interval = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            save_file = optarg;
+            break;
+        case 'c':
+            compare_file = optarg;
+            break;
+        case 'x':
+            if (search_count == MAX_CLI_SEARCHES) {
+                printf("At most %d searches\n", MAX_CLI_SEARCHES);
+                return 1;
+            }
+            searches[search_count++] = optarg;
+            break;
+        case 'm':
+            core_count = (int)strtol(optarg, NULL, 0);
+            multicore = TRUE;
+            break;
+        case 'M':
+            if (!multicore_add_image(optarg)) {
+                return 1;
+            }
+            multicore = TRUE;
+            break;
+        case 'k':
+            core_quantum = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            gdb_address = optarg;
+            break;
+        case 'S':
+            fork_server = TRUE;
+            break;
+        case 'V':
+            coverage_file = optarg;
+            break;
+        case 'L':
+            coverage_info = optarg;
+            break;
+        case 'H':
+            heatmap_file = optarg;
+            break;
+        case 'C':
+            callgraph_file = optarg;
+            break;
+        case 'y':
+            if (!callgraph_symbols(optarg)) {
+                return 1;
+            }
+            break;
+        case 'T':
+            if (!timing_load(optarg)) {
+                return 1;
+            }
+            break;
+        case 'W':
+            sweep_file = optarg;
+            break;
+        case 'j':
+            sweep_threads = (int)strtol(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Initialize signal handling
+    init_signal();
+
+    if (fork_server) {
+        return xm23_fork_server(machine, STDIN_FILENO, STDOUT_FILENO) < 0 ? 1 : 0;
+    }
+    if (gdb_address != NULL) {
+        return gdb_serve(gdb_address) ? 0 : 1;
+    }
+    if (sweep_file != NULL) {
+        return sweep_run(sweep_file, sweep_threads, cycle_limit) ? 0 : 1;
+    }
+    if (coverage_info != NULL && !batch_mode) { // Report on coverage saved by earlier runs
+        return coverage_file != NULL && coverage_load(coverage_file) && coverage_report(coverage_info, image_file) ? 0 : 1;
+    }
+    if (batch_mode) {
+        coverage_enabled = coverage_file != NULL || coverage_info != NULL;
+        return run_batch(lockstep_interval, save_file, compare_file, searches, search_count);
+    }
+
+    do {
+        printf("1. Load a new file\n");
+        printf("2. Start Emulation\n");
+        printf("3. Change memory value\n");
+        printf("4. Quit\n");
+        printf("Enter your choice: ");
+
+        if (scanf("%d", &choice) != 1) {
+            printf("Invalid input. Please enter a number.\n\n");
+            while ((temp_ch = getchar()) != '\n' && temp_ch != EOF); // Clear the invalid input
+            continue; // Skip the rest of the loop and prompt the user again
+        }
+
+        switch (choice) {
+        case 1:
+            loadFile();
+            breakpoint_set = FALSE; // Reset the breakpoint flag when a new file is loaded
+            break;
+        case 2:
+            program_running = TRUE; // Reset the program_running flag
+            user_control();
+            break;
+        case 3:
+            change_memory_value();
+            break;
+        case 4:
+            profiler_stop();
+            callgraph_stop();
+            printf("Exiting the program.\n");
+            program_running = 0;
+            break;
+        default:
+            printf("Invalid choice. Please try again.\n\n");
+        }
+    } while (choice != 4);
+
+    return 0;
+}
+
+/**
+ * @brief Run the loaded program without the menu, used for scripted runs and PGO training.
+ * @param lockstep_interval Slots between lockstep comparisons, 0 for a normal run.
+ * @param save_file Snapshot written when the run stops, or NULL.
+ * @param compare_file Snapshot compared with the final state, or NULL.
+ * @param searches Memory searches run when the program stops, see search_parse().
+ * @return 0 when the program stopped at the breakpoint, 1 if interrupted by Control-C or
+ *         a lockstep divergence, 2 if the final state differs from compare_file.
+ */
+int run_batch(unsigned int lockstep_interval, const char* save_file, const char* compare_file,
+              const char** searches, int search_count) {
+    static MachineState final_state, expected_state;
+    int control_c_detected;
+    int search;
+
+    if (search_count) { // Changed-since searches compare with the memories as loaded
+        search_record(instruction_mem);
+        search_record(data_mem);
+    }
+
+    program_running = TRUE;
+    if (multicore && lockstep_interval) {
+        printf("-l checks a single core and cannot be used with -m or -M\n");
+        return 1;
+    }
+    if (timing_active && (multicore || lockstep_interval)) {
+        printf("-T times a single core through CPU() and cannot be used with -m, -M or -l\n");
+        return 1;
+    }
+    if (multicore && (heatmap_file != NULL || callgraph_file != NULL)) {
+        printf("-H and -C profile a single core and cannot be used with -m or -M\n");
+        return 1;
+    }
+    if (heatmap_file != NULL) {
+        heatmap_reset(0);
+        heatmap_enabled = TRUE;
+    }
+    if (callgraph_file != NULL && !callgraph_start(callgraph_file)) {
+        return 1;
+    }
+    if (multicore) {
+        control_c_detected = multicore_run(core_count, core_quantum, cycle_limit);
+    }
+    else if (lockstep_interval) {
+        control_c_detected = lockstep_run(lockstep_interval);
+    }
+    else {
+        control_c_detected = xm23_run(machine, 0) == XM23_STOP_INTERRUPTED;
+    }
+
+    printf("Stopped at %04X after %u clock cycles%s\n", last_executed_address, cpu_clock,
+        control_c_detected ? " (interrupted)" : "");
+    displayRegisterFile();
+    if (timing_active) {
+        timing_report();
+    }
+    if (coverage_enabled && !coverage_finish()) {
+        return 1;
+    }
+    if (callgraph_enabled && !callgraph_stop()) {
+        return 1;
+    }
+    if (heatmap_enabled) {
+        heatmap_top(HEATMAP_SUMMARY_LINES);
+        if (!heatmap_export(heatmap_file)) {
+            return 1;
+        }
+    }
+
+    for (search = 0; search < search_count; search++) {
+        if (search_command(searches[search]) < 0) {
+            return 1;
+        }
+    }
+
+    state_capture(&final_state);
+    if (save_file != NULL && !state_save(&final_state, save_file)) {
+        return 1;
+    }
+    if (compare_file != NULL) {
+        if (!state_load(&expected_state, compare_file)) {
+            return 1;
+        }
+        if (state_diff(&expected_state, &final_state) != 0) {
+            return 2;
+        }
+        printf("Machine state matches %s\n", compare_file);
+    }
+
+    return control_c_detected ? 1 : 0;
+}
+
+/**
+ * @brief User control function for the emulator.
+ */
+void user_control() {
+    int ch;
+    char user_choice;
+    int menu_displayed = FALSE;
+    int single_step = FALSE;
+    int control_c_detected;
+
+    while (program_running) {
+        if (!menu_displayed) {
+            printf("\nWhat would you like to choose from the menu: \n");
+            printf("Press and enter I -> to Toggle Single Step Execution (currently %s)\n", single_step ? "Enabled" : "Disabled");
+            printf("Press and enter R -> to display Registers\n");
+            printf("Press and enter V -> to Change Register Value\n");
+            printf("Press and enter G -> to Go (execute continuously)\n");
+            printf("Press and enter B -> to Set Breakpoint\n");
+            printf("Press and enter P -> to Display PSW bits\n");
+            printf("Press and enter M -> to Display Memory\n");
+            printf("Press and enter F -> to Find a value or pattern in Memory\n");
+            printf("Press and enter T -> to Configure Trace Filters\n");
+            printf("Press and enter S -> to Start/Stop the Sampling Profiler (currently %s)\n", profiler_active ? "Running" : "Stopped");
+            printf("Press and enter H -> for the Data Memory Heatmap (currently %s)\n", heatmap_enabled ? "Counting" : "Stopped");
+            printf("Press and enter C -> to Start/Stop the Call-Graph Profiler (currently %s)\n", callgraph_enabled ? "Running" : "Stopped");
+            printf("Press and enter W -> to Load/Remove a Timing Model (currently %s)\n", timing_active ? "Loaded" : "Default");
+            printf("Press and enter D -> to Save, Diff, Reset or Lockstep-check the Machine State\n");
+            printf("Press and enter Q -> to Quit\n");
+            printf("Enter option here ==> ");
+            menu_displayed = TRUE; // Set the flag to indicate that the menu has been displayed
+        }
+        else {
+            printf("\nEnter option (or ? to display the menu) ==> ");
+        }
+
+        (void)scanf(" %c", &user_choice);
+        while ((ch = getchar()) != '\n' && ch != EOF);
+
+        if (user_choice == '?') {
+            menu_displayed = FALSE; // Reset the flag to display the menu again
+            continue;
+        }
+
+        switch (user_choice) {
+        case 'I':
+        case 'i':
+            single_step = !single_step; // Toggle the single step flag
+            printf("Single step is now %s.\n", single_step ? "Enabled" : "Disabled");
+            break;
+        case 'R':
+        case 'r':
+            displayRegisterFile();
+            break;
+        case 'V':
+        case 'v':
+            change_register_value();
+            break;
+        case 'G':
+        case 'g':
+            control_c_detected = FALSE;
+            if (single_step) {
+                // Single-step mode: Execute two clock cycles (even and odd)
+                run_xm(); // First clock cycle (even)
+                if (program_running) {
+                    run_xm(); // Second clock cycle (odd)
+                }
+            }
+            else {
+                // Continuous mode: Execute until the program is no longer running or a breakpoint is reached or control-C is detected
+                if (!breakpoint_set || last_executed_address != breakpoint_address) {
+                    profiler_resume();
+                    control_c_detected = run_xm_continuous();
+                    profiler_pause();
+                }
+                if (!control_c_detected) {
+                    printf("End of instruction execution cycle or breakpoint reached.\n\n");
+                }
+                else {
+                    printf("Execution interrupted by Control-C\n\n");
+                }
+            }
+            program_running = TRUE; // Reset the flag to keep the menu active
+            break;
+        case 'B':
+        case 'b':
+            set_breakpoint();
+            break;
+        case 'P':
+        case 'p':
+            displayPswBits();
+            break;
+        case 'M':
+        case 'm':
+            display_memory_submenu();
+            break;
+        case 'F':
+        case 'f':
+            mem_search_menu();
+            break;
+        case 'T':
+        case 't':
+            trace_filter_menu();
+            break;
+        case 'S':
+        case 's':
+            profiler_menu();
+            break;
+        case 'H':
+        case 'h':
+            heatmap_menu();
+            break;
+        case 'C':
+        case 'c':
+            callgraph_menu();
+            break;
+        case 'W':
+        case 'w':
+            timing_menu();
+            break;
+        case 'D':
+        case 'd':
+            state_diff_menu();
+            break;
+        case 'Q':
+        case 'q':
+            program_running = FALSE;
+            break; // Exit the user control function to end the program
+        default:
+            printf("Invalid option. Try again.\n\n");
+        }
+    }
+}
+
+/**
+ * @brief Submenu to display memory regions.
+ */
+void display_memory_submenu() {
+    int ch;
+    char mem_choice;
+
+    printf("\nDisplay which memory? (I for Instruction, D for Data, A for Disassembled instructions): ");
+    (void)scanf(" %c", &mem_choice);
+    while ((ch = getchar()) != '\n' && ch != EOF); //consume invalid input
+
+    switch (mem_choice) {
+    case 'I':
+    case 'i':
+        displayMemoryRegion(imemory.btmem);
+        break;
+    case 'D':
+    case 'd':
+        displayMemoryRegion(dmemory.btmem);
+        break;
+    case 'A':
+    case 'a':
+        displayDisassembly();
+        break;
+    default:
+        printf("Invalid option.\n\n");
+        break;
+    }
+}
+
+/**
+ * @brief Set a breakpoint at a specified address.
+ */
+void set_breakpoint() {
+    unsigned short address;
+    int ch;
+
+    printf("Enter the breakpoint address (in hexadecimal): ");
+    if (scanf("%4hx", &address) != 1) {
+        printf("Invalid address. Please enter a valid hexadecimal number.\n\n");
+        while ((ch = getchar()) != '\n' && ch != EOF); // Consume invalid input
+        return;
+    }
+
+    breakpoint_address = address;
+    breakpoint_set = TRUE; // Set the flag to indicate that a breakpoint has been set
+    printf("Breakpoint set at address: 0x%04X\n\n", breakpoint_address);
+
+    while ((ch = getchar()) != '\n' && ch != EOF); // Consume any leftover invalid input
+}
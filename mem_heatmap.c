@@ -0,0 +1,300 @@
+/**
+ * @file mem_heatmap.c
+ * @brief Data memory heatmap: reads and writes per 16-byte line, and bandwidth over time windows.
+ * @details While heatmap_enabled is set, every E1 access of LD, ST, LDR and STR adds one
+ *          constant to the counter of its line: the high half counts accesses and the low
+ *          half counts bytes, so a byte access adds HEATMAP_BYTE and a word access adds
+ *          HEATMAP_WORD. Bandwidth windows cost nothing per access beyond comparing the
+ *          clock with the end of the current window. The first access after a window ends
+ *          closes it by summing the counters and taking the difference with the previous
+ *          sum. Windows with no accesses are recorded as empty. When the window table is
+ *          full, neighbouring windows are merged and the window length doubles, so a run of
+ *          any length fits. The counts are for a single core.
+ */
+
+#include "Emulator.h"
+
+typedef struct {
+    unsigned int reads, read_bytes, writes, write_bytes;
+} HeatWindow;
+
+int heatmap_enabled = FALSE;
+unsigned long long heatmap_reads[HEATMAP_LINES];  // Accesses << 32 | bytes, per line
+unsigned long long heatmap_writes[HEATMAP_LINES];
+unsigned int heatmap_window_end;                   // Clock at which the open window ends
+
+static HeatWindow heatmap_windows[HEATMAP_MAX_WINDOWS];
+static int heatmap_window_count;
+static unsigned int heatmap_window_cycles = HEATMAP_DEFAULT_WINDOW;
+static unsigned int heatmap_start;                 // Clock at which the first window began
+static unsigned long long read_sum, write_sum;     // Counter sums when the open window began
+
+/**
+ * @brief Sum of the counters of every line.
+ */
+static unsigned long long heatmap_sum(const unsigned long long* lines) {
+    unsigned long long sum = 0;
+    int line;
+
+    for (line = 0; line < HEATMAP_LINES; line++) {
+        sum += lines[line];
+    }
+    return sum;
+}
+
+/**
+ * @brief Append a window, merging neighbours and doubling the window length if the table is full.
+ */
+static void heatmap_add_window(unsigned long long reads, unsigned long long writes) {
+    HeatWindow* window = &heatmap_windows[heatmap_window_count++];
+    int n;
+
+    window->reads = (unsigned int)(reads >> 32);
+    window->read_bytes = (unsigned int)reads;
+    window->writes = (unsigned int)(writes >> 32);
+    window->write_bytes = (unsigned int)writes;
+    if (heatmap_window_count == HEATMAP_MAX_WINDOWS) {
+        for (n = 0; n < HEATMAP_MAX_WINDOWS / 2; n++) {
+            heatmap_windows[n].reads = heatmap_windows[2 * n].reads + heatmap_windows[2 * n + 1].reads;
+            heatmap_windows[n].read_bytes = heatmap_windows[2 * n].read_bytes + heatmap_windows[2 * n + 1].read_bytes;
+            heatmap_windows[n].writes = heatmap_windows[2 * n].writes + heatmap_windows[2 * n + 1].writes;
+            heatmap_windows[n].write_bytes = heatmap_windows[2 * n].write_bytes + heatmap_windows[2 * n + 1].write_bytes;
+        }
+        heatmap_window_count = HEATMAP_MAX_WINDOWS / 2;
+        heatmap_window_cycles *= 2;
+    }
+    heatmap_window_end = heatmap_start + (heatmap_window_count + 1) * heatmap_window_cycles;
+}
+
+/**
+ * @brief Close the open window, and any empty ones after it, before an access at clock.
+ * @details Called from HEATMAP_COUNT() only when clock has reached heatmap_window_end, so every
+ *          access counted since the last call belongs to the window being closed.
+ */
+void heatmap_window_close(unsigned int clock) {
+    unsigned long long reads = heatmap_sum(heatmap_reads);
+    unsigned long long writes = heatmap_sum(heatmap_writes);
+
+    heatmap_add_window(reads - read_sum, writes - write_sum);
+    read_sum = reads;
+    write_sum = writes;
+    while ((int)(clock - heatmap_window_end) >= 0) {
+        heatmap_add_window(0, 0);
+    }
+}
+
+/**
+ * @brief Clear the counters and start the first window at the current clock.
+ * @param window_cycles Length of a bandwidth window, 0 for the default.
+ */
+void heatmap_reset(unsigned int window_cycles) {
+    memset(heatmap_reads, 0, sizeof(heatmap_reads));
+    memset(heatmap_writes, 0, sizeof(heatmap_writes));
+    read_sum = write_sum = 0;
+    heatmap_window_count = 0;
+    heatmap_window_cycles = window_cycles ? window_cycles : HEATMAP_DEFAULT_WINDOW;
+    heatmap_start = cpu_clock;
+    heatmap_window_end = heatmap_start + heatmap_window_cycles;
+}
+
+/**
+ * @brief Write the lines that were accessed and the bandwidth windows, as JSON if filename ends
+ *        in .json and as CSV otherwise.
+ * @details The CSV has one row per line and per window: kind,start,size,reads,read_bytes,writes,
+ *          write_bytes, where start and size are the address and 16 bytes of a line, or the
+ *          clock and length in cycles of a window. The open window is written as it stands.
+ * @return FALSE if the file cannot be written.
+ */
+int heatmap_export(const char* filename) {
+    const char* suffix = strrchr(filename, '.');
+    int json = suffix != NULL && strcmp(suffix, ".json") == 0;
+    unsigned long long open_reads = heatmap_sum(heatmap_reads) - read_sum;
+    unsigned long long open_writes = heatmap_sum(heatmap_writes) - write_sum;
+    HeatWindow window;
+    unsigned int start, cycles;
+    const char* separator = "";
+    FILE* out;
+    int line, n;
+
+    out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+
+    if (json) {
+        fprintf(out, "{\"line_bytes\": %d, \"window_cycles\": %u, \"lines\": [", HEATMAP_LINE_BYTES,
+            heatmap_window_cycles);
+    }
+    else {
+        fprintf(out, "kind,start,size,reads,read_bytes,writes,write_bytes\n");
+    }
+    for (line = 0; line < HEATMAP_LINES; line++) {
+        if (heatmap_reads[line] == 0 && heatmap_writes[line] == 0) {
+            continue;
+        }
+        if (json) {
+            fprintf(out, "%s\n  {\"address\": %d, \"reads\": %u, \"read_bytes\": %u, \"writes\": %u, \"write_bytes\": %u}",
+                separator, line * HEATMAP_LINE_BYTES, (unsigned int)(heatmap_reads[line] >> 32),
+                (unsigned int)heatmap_reads[line], (unsigned int)(heatmap_writes[line] >> 32),
+                (unsigned int)heatmap_writes[line]);
+            separator = ",";
+        }
+        else {
+            fprintf(out, "line,%d,%d,%u,%u,%u,%u\n", line * HEATMAP_LINE_BYTES, HEATMAP_LINE_BYTES,
+                (unsigned int)(heatmap_reads[line] >> 32), (unsigned int)heatmap_reads[line],
+                (unsigned int)(heatmap_writes[line] >> 32), (unsigned int)heatmap_writes[line]);
+        }
+    }
+
+    if (json) {
+        fprintf(out, "\n], \"windows\": [");
+        separator = "";
+    }
+    for (n = 0; n <= heatmap_window_count; n++) {
+        start = heatmap_start + n * heatmap_window_cycles;
+        if (n < heatmap_window_count) {
+            window = heatmap_windows[n];
+            cycles = heatmap_window_cycles;
+        }
+        else { // The open window, up to the current clock
+            cycles = cpu_clock - start;
+            if (cycles == 0) {
+                break;
+            }
+            if (cycles > heatmap_window_cycles) { // Ended, but no access has closed it yet
+                cycles = heatmap_window_cycles;
+            }
+            window.reads = (unsigned int)(open_reads >> 32);
+            window.read_bytes = (unsigned int)open_reads;
+            window.writes = (unsigned int)(open_writes >> 32);
+            window.write_bytes = (unsigned int)open_writes;
+        }
+        if (json) {
+            fprintf(out, "%s\n  {\"start\": %u, \"cycles\": %u, \"reads\": %u, \"read_bytes\": %u, \"writes\": %u, "
+                "\"write_bytes\": %u, \"bytes_per_cycle\": %.4f}", separator, start, cycles, window.reads,
+                window.read_bytes, window.writes, window.write_bytes,
+                (double)(window.read_bytes + window.write_bytes) / cycles);
+            separator = ",";
+        }
+        else {
+            fprintf(out, "window,%u,%u,%u,%u,%u,%u\n", start, cycles, window.reads, window.read_bytes, window.writes,
+                window.write_bytes);
+        }
+    }
+    if (json) {
+        fprintf(out, "\n]}\n");
+    }
+
+    if (fclose(out) != 0) {
+        printf("Error writing file >%s<\n\n", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int heatmap_compare(const void* a, const void* b) {
+    int line_a = *(const int*)a, line_b = *(const int*)b;
+    unsigned int total_a = (unsigned int)((heatmap_reads[line_a] >> 32) + (heatmap_writes[line_a] >> 32));
+    unsigned int total_b = (unsigned int)((heatmap_reads[line_b] >> 32) + (heatmap_writes[line_b] >> 32));
+
+    if (total_a != total_b) {
+        return total_a < total_b ? 1 : -1;
+    }
+    return line_a - line_b;
+}
+
+/**
+ * @brief Print the count hottest lines by accesses, and the overall and peak bandwidth.
+ */
+void heatmap_top(int count) {
+    static int order[HEATMAP_LINES];
+    unsigned long long reads = heatmap_sum(heatmap_reads), writes = heatmap_sum(heatmap_writes);
+    unsigned int total = (unsigned int)((reads >> 32) + (writes >> 32));
+    unsigned int cycles = cpu_clock - heatmap_start, peak = 0, bytes;
+    int lines = 0, line, n;
+
+    for (line = 0; line < HEATMAP_LINES; line++) {
+        if (heatmap_reads[line] != 0 || heatmap_writes[line] != 0) {
+            order[lines++] = line;
+        }
+    }
+    qsort(order, lines, sizeof(order[0]), heatmap_compare);
+
+    printf("%u data memory accesses (%u reads, %u writes) to %d lines over %u cycles\n", total,
+        (unsigned int)(reads >> 32), (unsigned int)(writes >> 32), lines, cycles);
+    printf("Line        Reads      Writes     Share\n");
+    for (n = 0; n < lines && n < count; n++) {
+        line = order[n];
+        printf("%04X-%04X  %-10u %-10u %5.1f%%\n", line * HEATMAP_LINE_BYTES, line * HEATMAP_LINE_BYTES + HEATMAP_LINE_BYTES - 1,
+            (unsigned int)(heatmap_reads[line] >> 32), (unsigned int)(heatmap_writes[line] >> 32),
+            100.0 * (double)((heatmap_reads[line] >> 32) + (heatmap_writes[line] >> 32)) / total);
+    }
+    for (n = 0; n < heatmap_window_count; n++) {
+        bytes = heatmap_windows[n].read_bytes + heatmap_windows[n].write_bytes;
+        peak = bytes > peak ? bytes : peak;
+    }
+    if (cycles != 0) {
+        printf("Bandwidth %.4f bytes/cycle overall, %.4f in the busiest of %d windows of %u cycles\n\n",
+            (double)((unsigned int)reads + (unsigned int)writes) / cycles, (double)peak / heatmap_window_cycles,
+            heatmap_window_count, heatmap_window_cycles);
+    }
+}
+
+/**
+ * @brief Interactive submenu: start or stop counting, show the hottest lines, export.
+ */
+void heatmap_menu() {
+    char user_choice;
+    char filename[BUFFER_LEN];
+    unsigned int window_cycles;
+    int count;
+    int ch;
+
+    printf("\nPress and enter S -> to Start or Stop counting data memory accesses (currently %s)\n",
+        heatmap_enabled ? "Counting" : "Stopped");
+    printf("Press and enter T -> to show the Top lines\n");
+    printf("Press and enter E -> to Export the counts and bandwidth windows (.csv or .json)\n");
+    printf("Enter option here ==> ");
+    (void)scanf(" %c", &user_choice);
+    while ((ch = getchar()) != '\n' && ch != EOF);
+
+    switch (user_choice) {
+    case 'S':
+    case 's':
+        if (heatmap_enabled) {
+            heatmap_enabled = FALSE;
+            printf("Counting stopped, the counts are kept.\n\n");
+            return;
+        }
+        printf("Enter the bandwidth window in clock cycles (0 for %d): ", HEATMAP_DEFAULT_WINDOW);
+        if (scanf("%u", &window_cycles) != 1) {
+            printf("Invalid input.\n\n");
+            break;
+        }
+        heatmap_reset(window_cycles);
+        heatmap_enabled = TRUE;
+        printf("Counting from clock %u.\n\n", cpu_clock);
+        break;
+    case 'T':
+    case 't':
+        printf("Enter the number of lines: ");
+        if (scanf("%d", &count) != 1 || count <= 0) {
+            printf("Invalid input.\n\n");
+            break;
+        }
+        heatmap_top(count);
+        break;
+    case 'E':
+    case 'e':
+        printf("Enter the file name: ");
+        if (scanf("%255s", filename) == 1 && heatmap_export(filename)) {
+            printf("Heatmap written to %s\n\n", filename);
+        }
+        break;
+    default:
+        printf("Invalid option.\n\n");
+        return;
+    }
+    while ((ch = getchar()) != '\n' && ch != EOF);
+}
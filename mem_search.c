@@ -0,0 +1,403 @@
+/**
+ * @file mem_search.c
+ * @brief Search instruction or data memory for a byte sequence, a word or a masked pattern.
+ * @details A pattern is anchored on its first and last significant bytes. Each 64-address
+ *          block is tested against both anchors with AVX2 or SSE2 compare and movemask
+ *          (picked once at run time, byte compares elsewhere), giving a 64-bit mask of
+ *          candidate addresses; only candidates are compared in full. Every search records
+ *          the memory it scanned, so a following search can keep only the addresses whose
+ *          bytes changed since then (for finding a guest variable by its new value).
+ */
+
+#include "Emulator.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SEARCH_X86 1
+#endif
+
+#define SEARCH_BLOCK 64          // Addresses per candidate mask
+#define SEARCH_HITS_PER_LINE 8
+#define EVEN_ADDRESSES 0x5555555555555555ULL
+
+typedef struct {
+    const SearchPattern* pattern;
+    const unsigned char* mem;
+    const unsigned char* previous; // Contents at the last search, NULL unless changed_only
+    unsigned short* hits;
+    int max_hits;
+    int count; // Hits found, max_hits + 1 once the list is full
+} SearchCollector;
+
+typedef void (*search_scan_fn)(SearchCollector*, unsigned int, unsigned int, unsigned int);
+
+static unsigned char search_previous[2][BTMEMSIZE]; // Memory contents at the last search, per memory
+static int search_recorded[2] = { FALSE, FALSE };
+static unsigned short search_hits[BTMEMSIZE];
+
+/**
+ * @brief Compare the whole pattern at address, and the changed-since-last-search condition.
+ */
+static int search_match(const SearchCollector* col, unsigned int address) {
+    const SearchPattern* pattern = col->pattern;
+    unsigned int i;
+
+    if (address + pattern->length > BTMEMSIZE) {
+        return FALSE;
+    }
+    for (i = 0; i < pattern->length; i++) {
+        if ((col->mem[address + i] & pattern->mask[i]) != pattern->value[i]) {
+            return FALSE;
+        }
+    }
+    return col->previous == NULL || memcmp(col->mem + address, col->previous + address, pattern->length) != 0;
+}
+
+/**
+ * @brief Check the candidate addresses of one block and record the hits.
+ * @return FALSE once max_hits is exceeded and scanning can stop.
+ */
+static int search_collect(SearchCollector* col, unsigned int base, unsigned long long candidates) {
+    if (col->pattern->aligned) {
+        candidates &= EVEN_ADDRESSES;
+    }
+    while (candidates) {
+#ifdef __GNUC__
+        unsigned int bit = (unsigned int)__builtin_ctzll(candidates);
+#else
+        unsigned int bit = 0;
+        while (!((candidates >> bit) & 1)) {
+            bit++;
+        }
+#endif
+        candidates &= candidates - 1;
+        if (search_match(col, base + bit)) {
+            if (col->count == col->max_hits) {
+                col->count = col->max_hits + 1;
+                return FALSE;
+            }
+            col->hits[col->count++] = (unsigned short)(base + bit);
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Portable scan, one address at a time on the two anchor bytes.
+ * @param end First block address that would read past the end of memory.
+ */
+static void search_scan_bytes(SearchCollector* col, unsigned int first, unsigned int last, unsigned int end) {
+    const SearchPattern* pattern = col->pattern;
+    unsigned int base, i;
+    unsigned long long candidates;
+
+    for (base = 0; base < end; base += SEARCH_BLOCK) {
+        candidates = 0;
+        for (i = 0; i < SEARCH_BLOCK; i++) {
+            if ((col->mem[base + i + first] & pattern->mask[first]) == pattern->value[first] &&
+                (col->mem[base + i + last] & pattern->mask[last]) == pattern->value[last]) {
+                candidates |= 1ULL << i;
+            }
+        }
+        if (candidates && !search_collect(col, base, candidates)) {
+            return;
+        }
+    }
+}
+
+#ifdef SEARCH_X86
+/**
+ * @brief SSE2 scan, four 16-address compares per anchor and block.
+ */
+__attribute__((target("sse2")))
+static void search_scan_sse2(SearchCollector* col, unsigned int first, unsigned int last, unsigned int end) {
+    const SearchPattern* pattern = col->pattern;
+    __m128i first_mask = _mm_set1_epi8((char)pattern->mask[first]);
+    __m128i first_value = _mm_set1_epi8((char)pattern->value[first]);
+    __m128i last_mask = _mm_set1_epi8((char)pattern->mask[last]);
+    __m128i last_value = _mm_set1_epi8((char)pattern->value[last]);
+    unsigned int base, i;
+    unsigned long long candidates;
+
+    for (base = 0; base < end; base += SEARCH_BLOCK) {
+        candidates = 0;
+        for (i = 0; i < SEARCH_BLOCK; i += 16) {
+            __m128i f = _mm_loadu_si128((const __m128i*)(col->mem + base + i + first));
+            __m128i l = _mm_loadu_si128((const __m128i*)(col->mem + base + i + last));
+            __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(f, first_mask), first_value),
+                                        _mm_cmpeq_epi8(_mm_and_si128(l, last_mask), last_value));
+            candidates |= (unsigned long long)(unsigned int)_mm_movemask_epi8(hit) << i;
+        }
+        if (candidates && !search_collect(col, base, candidates)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief AVX2 scan, two 32-address compares per anchor and block.
+ */
+__attribute__((target("avx2")))
+static void search_scan_avx2(SearchCollector* col, unsigned int first, unsigned int last, unsigned int end) {
+    const SearchPattern* pattern = col->pattern;
+    __m256i first_mask = _mm256_set1_epi8((char)pattern->mask[first]);
+    __m256i first_value = _mm256_set1_epi8((char)pattern->value[first]);
+    __m256i last_mask = _mm256_set1_epi8((char)pattern->mask[last]);
+    __m256i last_value = _mm256_set1_epi8((char)pattern->value[last]);
+    unsigned int base, i;
+    unsigned long long candidates;
+
+    for (base = 0; base < end; base += SEARCH_BLOCK) {
+        candidates = 0;
+        for (i = 0; i < SEARCH_BLOCK; i += 32) {
+            __m256i f = _mm256_loadu_si256((const __m256i*)(col->mem + base + i + first));
+            __m256i l = _mm256_loadu_si256((const __m256i*)(col->mem + base + i + last));
+            __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(f, first_mask), first_value),
+                                           _mm256_cmpeq_epi8(_mm256_and_si256(l, last_mask), last_value));
+            candidates |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(hit) << i;
+        }
+        if (candidates && !search_collect(col, base, candidates)) {
+            return;
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Pick the widest compare the host supports, once.
+ */
+static search_scan_fn search_select_scan() {
+    static search_scan_fn scan = NULL;
+
+    if (scan == NULL) {
+        scan = search_scan_bytes;
+#ifdef SEARCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            scan = search_scan_avx2;
+        }
+        else if (__builtin_cpu_supports("sse2")) {
+            scan = search_scan_sse2;
+        }
+#endif
+    }
+    return scan;
+}
+
+/**
+ * @brief Find every address where pattern matches in one memory.
+ * @param hits Receives at most max_hits addresses, in ascending order.
+ * @return Number of hits stored, or max_hits + 1 if there are more.
+ */
+int mem_search(const unsigned char* mem, const SearchPattern* pattern, const unsigned char* previous,
+               unsigned short* hits, int max_hits) {
+    SearchCollector col;
+    unsigned int first = 0, last = 0, end, address, i;
+
+    col.pattern = pattern;
+    col.mem = mem;
+    col.previous = pattern->changed_only ? previous : NULL;
+    col.hits = hits;
+    col.max_hits = max_hits;
+    col.count = 0;
+
+    // Anchor on the first and last bytes that are not entirely wildcards (offset 0 if none is)
+    for (i = 0; i < pattern->length; i++) {
+        if (pattern->mask[i]) {
+            if (!pattern->mask[first]) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    // Whole blocks whose anchor loads stay inside memory go to the vector scan, the rest are checked one by one
+    end = (BTMEMSIZE - last) & ~(SEARCH_BLOCK - 1);
+    search_select_scan()(&col, first, last, end);
+    for (address = end; address < BTMEMSIZE && col.count <= max_hits; address++) {
+        if ((!pattern->aligned || !(address & 1)) && search_match(&col, address)) {
+            if (col.count == max_hits) {
+                col.count = max_hits + 1;
+                break;
+            }
+            hits[col.count++] = (unsigned short)address;
+        }
+    }
+    return col.count;
+}
+
+/**
+ * @brief Read hex digits (and '?' for any nibble) into value and mask nibbles, most significant first.
+ * @return Number of nibbles read, or -1 on an invalid character or too many nibbles.
+ */
+static int parse_nibbles(const char* text, unsigned char* value, unsigned char* mask, int max_nibbles) {
+    int count = 0;
+
+    for (; *text; text++) {
+        if (isspace((unsigned char)*text)) {
+            continue;
+        }
+        if (count == max_nibbles) {
+            return -1;
+        }
+        if (*text == '?') {
+            value[count] = 0;
+            mask[count] = 0;
+        }
+        else if (isxdigit((unsigned char)*text)) {
+            value[count] = (unsigned char)(isdigit((unsigned char)*text) ? *text - '0' : (toupper((unsigned char)*text) - 'A' + 10));
+            mask[count] = 0x0F;
+        }
+        else {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Parse a search such as "dw:1234" into the memory to search and a pattern.
+ * @details Format is <i|d>[c]<b|w|u>:<hex>. i or d picks the memory, c keeps only addresses
+ *          that changed since the last search, b is a byte sequence, w a word at an even
+ *          address and u a word at any address. Words are written most significant digit
+ *          first and stored little endian; '?' matches any nibble in either form.
+ * @return TRUE if the search is valid.
+ */
+int search_parse(const char* spec, SearchPattern* pattern, enum INST_OR_DATA_MEM* memory) {
+    unsigned char value[SEARCH_MAX_PATTERN * 2], mask[SEARCH_MAX_PATTERN * 2];
+    int nibbles, i;
+    char kind;
+
+    memset(pattern, 0, sizeof(*pattern));
+    switch (tolower((unsigned char)*spec++)) {
+    case 'i': *memory = instruction_mem; break;
+    case 'd': *memory = data_mem; break;
+    default: return FALSE;
+    }
+    if (tolower((unsigned char)*spec) == 'c') {
+        pattern->changed_only = TRUE;
+        spec++;
+    }
+    kind = (char)tolower((unsigned char)*spec++);
+    if (*spec++ != ':') {
+        return FALSE;
+    }
+
+    if (kind == 'b') {
+        nibbles = parse_nibbles(spec, value, mask, SEARCH_MAX_PATTERN * 2);
+        if (nibbles <= 0 || (nibbles & 1)) {
+            return FALSE;
+        }
+        pattern->length = (unsigned int)nibbles / 2;
+        for (i = 0; i < (int)pattern->length; i++) {
+            pattern->value[i] = (unsigned char)(value[2 * i] << 4 | value[2 * i + 1]);
+            pattern->mask[i] = (unsigned char)(mask[2 * i] << 4 | mask[2 * i + 1]);
+        }
+        return TRUE;
+    }
+    if (kind == 'w' || kind == 'u') {
+        unsigned short word_value = 0, word_mask = 0;
+
+        nibbles = parse_nibbles(spec, value, mask, 4);
+        if (nibbles <= 0) {
+            return FALSE;
+        }
+        for (i = 0; i < nibbles; i++) { // Missing leading digits are zero
+            word_value = (unsigned short)(word_value << 4 | value[i]);
+            word_mask = (unsigned short)(word_mask << 4 | mask[i]);
+        }
+        word_mask |= (unsigned short)~(0xFFFFu >> (16 - 4 * nibbles)) & 0xFFFF;
+        pattern->length = 2;
+        pattern->value[0] = (unsigned char)(word_value & 0xFF);
+        pattern->value[1] = (unsigned char)(word_value >> 8);
+        pattern->mask[0] = (unsigned char)(word_mask & 0xFF);
+        pattern->mask[1] = (unsigned char)(word_mask >> 8);
+        pattern->aligned = kind == 'w';
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Remember the current contents of a memory for the next changed-since search.
+ */
+void search_record(enum INST_OR_DATA_MEM memory) {
+    memcpy(search_previous[memory], memory == instruction_mem ? imemory.btmem : dmemory.btmem, BTMEMSIZE);
+    search_recorded[memory] = TRUE;
+}
+
+/**
+ * @brief Run a search given as text, print every hit and record the memory for the next search.
+ * @return Number of hits, or -1 if the search is invalid.
+ */
+int search_command(const char* spec) {
+    SearchPattern pattern;
+    enum INST_OR_DATA_MEM memory;
+    int count, hit;
+
+    if (!search_parse(spec, &pattern, &memory)) {
+        printf("Invalid search >%s<, use <i|d>[c]<b|w|u>:<hex> (e.g. dw:1234, ib:4C ?8, dcw:0005)\n\n", spec);
+        return -1;
+    }
+    if (pattern.changed_only && !search_recorded[memory]) {
+        printf("No earlier search of %s memory, every match is reported.\n",
+            memory == instruction_mem ? "instruction" : "data");
+        pattern.changed_only = FALSE;
+    }
+
+    count = mem_search(memory == instruction_mem ? imemory.btmem : dmemory.btmem, &pattern,
+        search_previous[memory], search_hits, BTMEMSIZE);
+    search_record(memory);
+
+    printf("%d hit(s) for %s", count, spec);
+    for (hit = 0; hit < count; hit++) {
+        printf("%s%04X", hit % SEARCH_HITS_PER_LINE ? " " : "\n  ", search_hits[hit]);
+    }
+    printf("\n\n");
+    return count;
+}
+
+/**
+ * @brief Interactive search of instruction or data memory.
+ */
+void mem_search_menu() {
+    char mem_choice, kind_choice;
+    char spec[BUFFER_LEN + 8], text[BUFFER_LEN];
+    const char* kind;
+    int ch;
+
+    printf("\nSearch which memory? (I for Instruction, D for Data): ");
+    (void)scanf(" %c", &mem_choice);
+    while ((ch = getchar()) != '\n' && ch != EOF);
+    if (tolower((unsigned char)mem_choice) != 'i' && tolower((unsigned char)mem_choice) != 'd') {
+        printf("Invalid option.\n\n");
+        return;
+    }
+
+    printf("Press and enter B -> to Find a byte sequence (? matches any nibble, e.g. 4C ?8 00)\n");
+    printf("Press and enter W -> to Find a word at even addresses (e.g. 1234, ? matches any nibble)\n");
+    printf("Press and enter U -> to Find a word at any address\n");
+    printf("Press and enter C -> to Find words that changed to a value since the last search\n");
+    printf("Enter option here ==> ");
+    (void)scanf(" %c", &kind_choice);
+    while ((ch = getchar()) != '\n' && ch != EOF);
+
+    switch (kind_choice) {
+    case 'B': case 'b': kind = "b"; break;
+    case 'W': case 'w': kind = "w"; break;
+    case 'U': case 'u': kind = "u"; break;
+    case 'C': case 'c': kind = "cw"; break;
+    default:
+        printf("Invalid option.\n\n");
+        return;
+    }
+
+    printf("Enter the value in hexadecimal: ");
+    if (fgets(text, sizeof(text), stdin) == NULL) {
+        return;
+    }
+    text[strcspn(text, "\r\n")] = '\0';
+    snprintf(spec, sizeof(spec), "%c%s:%s", tolower((unsigned char)mem_choice), kind, text);
+    search_command(spec);
+}
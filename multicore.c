@@ -0,0 +1,281 @@
+/**
+ * @file multicore.c
+ * @brief Several XM-23 cores sharing one data memory, each running on its own host thread.
+ * @details The per-core globals are thread-local (XM_CORE), so a core on its own thread has
+ *          its own registers, PSW, pipeline, events and memories, and every handler works
+ *          unchanged. Data memory is shared in quanta. At the start of a quantum each core
+ *          copies the shared data memory into its own, runs until its clock reaches the end
+ *          of the quantum, and finds the bytes it changed. The coordinating thread then
+ *          writes those changes into the shared memory in core order, so when two cores
+ *          store to the same byte in one quantum the higher numbered core wins. Other cores
+ *          see a store at the next quantum. The outcome depends only on the quantum length,
+ *          never on how the host schedules the threads. A quantum of 0 selects strict
+ *          lockstep: one instruction slot per quantum, every tick through CPU().
+ *          Core 0 runs the loaded program. Each image added with multicore_add_image() gives
+ *          the next core its own instruction memory and start address; the other cores run
+ *          core 0's image. Every core starts from the current machine
+ *          state, with its core number in R0.
+ */
+
+#include "Emulator.h"
+#include <pthread.h>
+
+#define MC_MAX_RUNS (BTMEMSIZE / 2) // Changed runs one quantum can leave, bytes changing in every other address
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    union mem* image;      // Instruction memory the core starts with
+    unsigned short start;  // and its start address
+    union mem* memory;     // The core's own data memory, its thread's dmemory
+    DiffRun* runs;         // Bytes the core changed during the last quantum
+    int run_count;
+    int running;
+    MachineState* final;   // State when the run ended, with the final shared data memory
+} XmCore;
+
+static XmCore cores[MC_MAX_CORES];
+static union mem* images[MC_MAX_CORES - 1]; // Private images for cores 1 and up
+static unsigned short image_starts[MC_MAX_CORES - 1];
+static int image_count = 0;
+
+static union mem shared_memory; // Data memory as all cores see it at the start of a quantum
+static pthread_barrier_t quantum_start, quantum_end;
+static pthread_mutex_t start_gate = PTHREAD_MUTEX_INITIALIZER; // Held while the cores are created
+static unsigned int quantum_target; // Clock value every core runs to in the current quantum
+static int keep_running;
+static int lockstep_mode;
+static MachineState start_state; // Machine state every core starts from
+static unsigned short start_breakpoint; // Breakpoint given to every core
+static int start_breakpoint_set;
+
+/**
+ * @brief Load a .xme file as the instruction memory of the next core.
+ * @details The data records go into the data memory all cores will share; the loaded
+ *          program of core 0 is left as it was.
+ * @return TRUE if the file was loaded.
+ */
+int multicore_add_image(const char* filename) {
+    static union mem saved;
+    unsigned short saved_pc = PC;
+    union mem* image;
+    int loaded;
+
+    if (image_count == MC_MAX_CORES - 1) {
+        printf("At most %d cores\n", MC_MAX_CORES);
+        return FALSE;
+    }
+    image = malloc(sizeof(*image));
+    if (image == NULL) {
+        printf("Out of memory for the image of %s\n", filename);
+        return FALSE;
+    }
+
+    memcpy(&saved, &imemory, sizeof(saved));
+    memset(&imemory, 0, sizeof(imemory));
+    loaded = load_xme_file(filename);
+    memcpy(image, &imemory, sizeof(*image));
+    image_starts[image_count] = PC;
+    memcpy(&imemory, &saved, sizeof(imemory));
+    PC = saved_pc;
+
+    if (!loaded) {
+        free(image);
+        return FALSE;
+    }
+    images[image_count++] = image;
+    return TRUE;
+}
+
+/**
+ * @brief Run the calling thread's core until its clock reaches target.
+ */
+static void core_run(unsigned int target) {
+    unsigned int cycles, stop;
+
+    while (program_running && (int)(cpu_clock - target) < 0) {
+        cycles = sched_cycles_until_next(target - cpu_clock);
+        if (cycles >= 2 && !lockstep_mode) {
+            CPU_fused(cycles / 2);
+        }
+        else {
+            stop = cpu_clock + cycles;
+            while (program_running && (int)(cpu_clock - stop) < 0) {
+                CPU();
+            }
+        }
+        sched_dispatch();
+        if (!lockstep_mode) {
+            idle_skip();
+        }
+    }
+}
+
+/**
+ * @brief Host thread of one core: set up its state, then run one quantum per barrier pair.
+ */
+static void* core_thread(void* arg) {
+    XmCore* core = arg;
+#ifdef DEBUG
+    DiagnosticInfo ring[diagnostic_ring]; // The trace is off on the cores, CPU() only needs somewhere to write
+
+    diagnostics = ring;
+    diagnostic_size = diagnostic_ring;
+    diag_index = 0;
+#endif
+
+    state_restore(&start_state);
+    memcpy(&imemory, core->image, sizeof(imemory));
+    regfile[0][0] = (unsigned short)core->id;
+    PC = core->start;
+    breakpoint_address = start_breakpoint;
+    breakpoint_set = start_breakpoint_set;
+    core->memory = &dmemory;
+    memset(dirty_pages, 0xFF, sizeof(dirty_pages)); // The memories are not those of any reset image
+    pthread_mutex_lock(&start_gate); // The barriers are ready once the gate opens
+    pthread_mutex_unlock(&start_gate);
+
+    while (1) {
+        pthread_barrier_wait(&quantum_start);
+        if (!keep_running) {
+            break;
+        }
+        core->run_count = 0;
+        if (program_running) {
+            memcpy(&dmemory, &shared_memory, sizeof(dmemory));
+            core_run(quantum_target);
+            core->run_count = diff_memory(shared_memory.btmem, dmemory.btmem, BTMEMSIZE, core->runs, MC_MAX_RUNS);
+        }
+        core->running = program_running;
+        pthread_barrier_wait(&quantum_end);
+    }
+
+    memcpy(&dmemory, &shared_memory, sizeof(dmemory));
+    state_capture(core->final);
+    if (coverage_enabled) {
+        coverage_core_finish();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Print the final state of every core.
+ */
+static void multicore_report(int count) {
+    const MachineState* state;
+    unsigned short psw_word;
+    int n, r;
+
+    for (n = 0; n < count; n++) {
+        state = cores[n].final;
+        memcpy(&psw_word, &state->psw, sizeof(psw_word));
+        printf("Core %d stopped at %04X after %u clock cycles\n ", n, state->last_executed_address, state->clock);
+        for (r = 0; r < NUM_REG_OR_CONS; r++) {
+            printf(" R%d %04X", r, state->regs[r]);
+        }
+        printf("  PSW %04X\n", psw_word);
+    }
+}
+
+/**
+ * @brief Run the loaded program on several cores sharing the data memory.
+ * @param count Number of cores, raised to cover every image from multicore_add_image().
+ * @param quantum Clock cycles between two exchanges of shared memory, 0 for strict lockstep.
+ * @param cycle_limit Stop once the cores reach this clock value, 0 for no limit.
+ * @details When the run ends, core 0's state and the shared data memory become the machine
+ *          state shown by the menu.
+ * @return TRUE if the run was interrupted by ^C or could not be started.
+ */
+int multicore_run(int count, unsigned int quantum, unsigned int cycle_limit) {
+    int saved_trace = trace_enabled;
+    int interrupted = FALSE;
+    int any_running, n, run, started;
+
+    if (count < image_count + 1) {
+        count = image_count + 1;
+    }
+    if (count < 1 || count > MC_MAX_CORES) {
+        printf("Between 1 and %d cores\n", MC_MAX_CORES);
+        return TRUE;
+    }
+
+    cpu_fused_init();    // Shared by the cores, built before they start
+    trace_enabled = FALSE; // Cores on several threads cannot share the trace
+    lockstep_mode = (quantum == 0);
+    memcpy(&shared_memory, &dmemory, sizeof(shared_memory));
+    state_capture(&start_state);
+    coverage_cores_start(); // Each core adds its coverage to this thread's as it finishes
+    start_breakpoint = breakpoint_address;
+    start_breakpoint_set = breakpoint_set;
+    quantum_target = cpu_clock;
+    keep_running = TRUE;
+    ctrl_c_fnd = FALSE;
+    pthread_mutex_lock(&start_gate);
+
+    for (started = 0; started < count; started++) {
+        XmCore* core = &cores[started];
+
+        core->id = started;
+        core->image = (started >= 1 && started <= image_count) ? images[started - 1] : &imemory;
+        core->start = (started >= 1 && started <= image_count) ? image_starts[started - 1] : PC;
+        core->run_count = 0;
+        core->running = TRUE;
+        core->runs = malloc(sizeof(*core->runs) * MC_MAX_RUNS);
+        core->final = malloc(sizeof(*core->final));
+        if (core->runs == NULL || core->final == NULL ||
+            pthread_create(&core->thread, NULL, core_thread, core) != 0) {
+            printf("Could not start core %d\n", started);
+            free(core->runs);
+            free(core->final);
+            keep_running = FALSE; // The cores already started stop at the first barrier
+            interrupted = TRUE;
+            break;
+        }
+    }
+    pthread_barrier_init(&quantum_start, NULL, (unsigned int)started + 1);
+    pthread_barrier_init(&quantum_end, NULL, (unsigned int)started + 1);
+    pthread_mutex_unlock(&start_gate);
+
+    while (keep_running) {
+        quantum_target += quantum ? quantum : 2;
+        if (cycle_limit && quantum_target >= cycle_limit) {
+            quantum_target = cycle_limit;
+        }
+        pthread_barrier_wait(&quantum_start);
+        pthread_barrier_wait(&quantum_end);
+
+        any_running = FALSE;
+        for (n = 0; n < count; n++) { // Core order, so a later core's store to the same byte wins
+            for (run = 0; run < cores[n].run_count; run++) {
+                memcpy(&shared_memory.btmem[cores[n].runs[run].start], &cores[n].memory->btmem[cores[n].runs[run].start],
+                    cores[n].runs[run].length);
+            }
+            any_running |= cores[n].running;
+        }
+        if (ctrl_c_fnd) {
+            ctrl_c_fnd = FALSE;
+            interrupted = TRUE;
+        }
+        if (!any_running || interrupted || (cycle_limit && quantum_target == cycle_limit)) {
+            keep_running = FALSE;
+        }
+    }
+    pthread_barrier_wait(&quantum_start); // The cores see keep_running cleared and finish
+
+    for (n = 0; n < started; n++) {
+        pthread_join(cores[n].thread, NULL);
+    }
+    pthread_barrier_destroy(&quantum_start);
+    pthread_barrier_destroy(&quantum_end);
+    trace_enabled = saved_trace;
+
+    if (started == count) {
+        multicore_report(count);
+        state_restore(cores[0].final);
+    }
+    for (n = 0; n < started; n++) {
+        free(cores[n].runs);
+        free(cores[n].final);
+    }
+    return interrupted;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file sample_profiler.c
+ * @brief Low-overhead sampling profiler for guest code.
+ * @details A host interval timer (ITIMER_PROF) delivers SIGPROF while the emulator runs.
+ *          The handler copies the executing address, LR and a short call stack into a
+ *          preallocated buffer. CPU() keeps those in the globals; CPU_fused() keeps them in
+ *          locals and, while the profiler is on, also stores them once per instruction, so a
+ *          sampled run keeps the fused loop and idle loop skipping. Samples are folded
+ *          into collapsed-stack format ("caller;callee;leaf count") for flame graph tools.
+ */
+
+#include "Emulator.h"
+#include <sys/time.h>
+
+typedef struct {
+    unsigned short depth;                   // Number of valid frames
+    unsigned short frames[PROF_STACK_DEPTH]; // frames[0] is the executing address, then call sites
+} ProfSample;
+
+int profiler_active = FALSE;
+static unsigned int profiler_rate = PROF_DEFAULT_RATE; // Samples per second of host CPU time
+static char profiler_file[BUFFER_LEN] = "xm23_profile.folded";
+static ProfSample* prof_samples = NULL;
+static volatile sig_atomic_t prof_count = 0;
+static unsigned long prof_dropped = 0;
+
+/**
+ * @brief Check that a return address follows a BL, which makes it a plausible frame.
+ */
+static int is_return_address(unsigned short address) {
+    if ((address & 1) || address < PC_INCREMENT) {
+        return FALSE;
+    }
+    return FIRST_3_BITS(imemory.wdmem[(address - PC_INCREMENT) >> 1]) == 0x00; // BL opcode
+}
+
+/**
+ * @brief SIGPROF handler: record one sample. Only reads emulator state, so it is async-signal-safe.
+ */
+static void prof_hdlr(int signum) {
+    ProfSample* sample;
+    unsigned short stack_ptr, word;
+    int scan;
+
+    (void)signum;
+    if (prof_count >= PROF_MAX_SAMPLES) {
+        prof_dropped++;
+        return;
+    }
+
+    sample = &prof_samples[prof_count];
+    sample->frames[0] = last_executed_address;
+    sample->depth = 1;
+
+    // LR holds the return address of the innermost call until the callee overwrites it
+    if (is_return_address(LR)) {
+        sample->frames[sample->depth++] = LR - PC_INCREMENT;
+    }
+
+    // Older return addresses are found on the stack, where non-leaf functions saved LR
+    stack_ptr = SP & ~1u;
+    for (scan = 0; scan < PROF_STACK_SCAN && sample->depth < PROF_STACK_DEPTH; scan++, stack_ptr += PC_INCREMENT) {
+        word = dmemory.wdmem[stack_ptr >> 1];
+        if (is_return_address(word) && word - PC_INCREMENT != sample->frames[sample->depth - 1]) {
+            sample->frames[sample->depth++] = word - PC_INCREMENT;
+        }
+    }
+
+    prof_count++;
+}
+
+/**
+ * @brief Arm or disarm the host interval timer.
+ */
+static void prof_set_timer(unsigned int rate) {
+    struct itimerval timer;
+
+    memset(&timer, 0, sizeof(timer));
+    if (rate != 0) {
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = 1000000 / rate;
+        timer.it_value = timer.it_interval;
+    }
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+/**
+ * @brief Start sampling at the given rate (in Hz) and write folded stacks to filename on stop.
+ * @return TRUE on success.
+ */
+int profiler_start(unsigned int rate, const char* filename) {
+    struct sigaction action;
+
+    if (rate == 0 || rate > 1000000) {
+        printf("Invalid sampling rate.\n");
+        return FALSE;
+    }
+    if (prof_samples == NULL) {
+        prof_samples = malloc(sizeof(ProfSample) * PROF_MAX_SAMPLES);
+        if (prof_samples == NULL) {
+            printf("Unable to allocate the sample buffer.\n");
+            return FALSE;
+        }
+    }
+
+    profiler_rate = rate;
+    strncpy(profiler_file, filename, BUFFER_LEN - 1);
+    prof_count = 0;
+    prof_dropped = 0;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = prof_hdlr;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, NULL);
+
+    profiler_active = TRUE;
+    return TRUE;
+}
+
+/**
+ * @brief Enable sample delivery, called before the emulator starts running.
+ */
+void profiler_resume() {
+    if (profiler_active) {
+        prof_set_timer(profiler_rate);
+    }
+}
+
+/**
+ * @brief Disable sample delivery, called when the emulator returns to the menu.
+ */
+void profiler_pause() {
+    if (profiler_active) {
+        prof_set_timer(0);
+    }
+}
+
+/**
+ * @brief Order samples so that identical stacks become neighbours.
+ */
+static int compare_samples(const void* a, const void* b) {
+    const ProfSample* left = a;
+    const ProfSample* right = b;
+
+    if (left->depth != right->depth) {
+        return left->depth - right->depth;
+    }
+    return memcmp(left->frames, right->frames, left->depth * sizeof(left->frames[0]));
+}
+
+/**
+ * @brief Write one folded line, outermost frame first.
+ */
+static void write_folded_stack(FILE* out, const ProfSample* sample, unsigned long count) {
+    int frame;
+
+    for (frame = sample->depth - 1; frame >= 0; frame--) {
+        fprintf(out, "0x%04X%s", sample->frames[frame], frame ? ";" : "");
+    }
+    fprintf(out, " %lu\n", count);
+}
+
+/**
+ * @brief Stop sampling and write the collapsed stacks.
+ */
+void profiler_stop() {
+    FILE* out;
+    int index, first;
+
+    if (!profiler_active) {
+        return;
+    }
+    prof_set_timer(0);
+    signal(SIGPROF, SIG_IGN);
+    profiler_active = FALSE;
+
+    out = fopen(profiler_file, "w");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", profiler_file);
+        return;
+    }
+
+    qsort(prof_samples, prof_count, sizeof(ProfSample), compare_samples);
+    for (first = 0, index = 1; index <= prof_count; index++) {
+        if (index == prof_count || compare_samples(&prof_samples[first], &prof_samples[index]) != 0) {
+            write_folded_stack(out, &prof_samples[first], index - first);
+            first = index;
+        }
+    }
+    fclose(out);
+
+    printf("%d samples written to %s", (int)prof_count, profiler_file);
+    if (prof_dropped) {
+        printf(" (%lu dropped, buffer full)", prof_dropped);
+    }
+    printf("\n\n");
+}
+
+/**
+ * @brief Interactive start/stop of the sampling profiler.
+ */
+void profiler_menu() {
+    unsigned int rate;
+    char filename[BUFFER_LEN];
+    int ch;
+
+    if (profiler_active) {
+        profiler_stop();
+        return;
+    }
+
+    printf("Enter the sampling rate in Hz and the output file (rate file: 1000 profile.folded): ");
+    if (scanf("%u %255s", &rate, filename) != 2) {
+        printf("Invalid input.\n\n");
+    }
+    else if (profiler_start(rate, filename)) {
+        printf("Sampling profiler started at %u Hz, samples are taken while the program runs.\n\n", rate);
+    }
+    while ((ch = getchar()) != '\n' && ch != EOF);
+}
@@ -0,0 +1,186 @@
+/**
+ * @file scheduler.c
+ * @brief Device event scheduler keyed on cpu_clock.
+ * @details Devices post a callback for a future clock value instead of polling every
+ *          half-cycle. Pending events sit in a binary min-heap ordered by clock (then by
+ *          posting order), so the run loop only looks at the earliest one: it runs the CPU
+ *          straight up to that clock value and then calls sched_dispatch(). Between events
+ *          no device code runs, however many are attached. Clock values are compared as a
+ *          signed distance, so events keep their order when cpu_clock wraps.
+ */
+
+#include "Emulator.h"
+
+typedef struct {
+    unsigned int when;
+    unsigned int sequence; // Posting order, keeps events due at the same clock first in, first out
+    sched_fn fn;
+    void* context;
+} SchedEvent;
+
+XM_CORE int sched_pending = 0; // Events posted and not yet dispatched or cancelled
+
+// Every core has its own devices, and so its own events
+static XM_CORE SchedEvent events[SCHED_MAX_EVENTS]; // Indexed by event id
+static XM_CORE int heap[SCHED_MAX_EVENTS];          // Event ids, earliest at heap[0]
+static XM_CORE int heap_index[SCHED_MAX_EVENTS];    // Position of each id in heap, -1 when free
+static XM_CORE unsigned int next_sequence = 0;
+static XM_CORE int heap_ready = FALSE;
+
+/**
+ * @brief TRUE if event a is due before event b.
+ */
+static int sched_before(int a, int b) {
+    int distance = (int)(events[a].when - events[b].when);
+
+    return distance < 0 || (distance == 0 && (int)(events[a].sequence - events[b].sequence) < 0);
+}
+
+static void heap_place(int position, int id) {
+    heap[position] = id;
+    heap_index[id] = position;
+}
+
+static void sift_up(int position) {
+    int id = heap[position];
+
+    while (position > 0 && sched_before(id, heap[(position - 1) / 2])) {
+        heap_place(position, heap[(position - 1) / 2]);
+        position = (position - 1) / 2;
+    }
+    heap_place(position, id);
+}
+
+static void sift_down(int position) {
+    int id = heap[position];
+    int child;
+
+    while ((child = 2 * position + 1) < sched_pending) {
+        if (child + 1 < sched_pending && sched_before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!sched_before(heap[child], id)) {
+            break;
+        }
+        heap_place(position, heap[child]);
+        position = child;
+    }
+    heap_place(position, id);
+}
+
+/**
+ * @brief Take the event at a heap position out of the heap.
+ */
+static void heap_remove(int position) {
+    int moved;
+
+    heap_index[heap[position]] = -1;
+    if (--sched_pending > position) { // Fill the hole with the last event and restore the order around it
+        moved = heap[sched_pending];
+        heap_place(position, moved);
+        sift_down(position);
+        sift_up(heap_index[moved]);
+    }
+}
+
+/**
+ * @brief Drop every pending event.
+ */
+void sched_clear() {
+    int id;
+
+    for (id = 0; id < SCHED_MAX_EVENTS; id++) {
+        heap_index[id] = -1;
+    }
+    sched_pending = 0;
+    heap_ready = TRUE;
+}
+
+/**
+ * @brief Call fn(context, when) once cpu_clock reaches when.
+ * @return Event id for sched_cancel(), or -1 if SCHED_MAX_EVENTS events are already pending.
+ */
+int sched_post(unsigned int when, sched_fn fn, void* context) {
+    int id;
+
+    if (!heap_ready) {
+        sched_clear();
+    }
+    for (id = 0; id < SCHED_MAX_EVENTS && heap_index[id] >= 0; id++);
+    if (id == SCHED_MAX_EVENTS) {
+        return -1;
+    }
+
+    events[id].when = when;
+    events[id].sequence = next_sequence++;
+    events[id].fn = fn;
+    events[id].context = context;
+    heap_place(sched_pending++, id);
+    sift_up(sched_pending - 1);
+    return id;
+}
+
+/**
+ * @brief Post an event cycles clock ticks from now.
+ */
+int sched_post_in(unsigned int cycles, sched_fn fn, void* context) {
+    return sched_post(cpu_clock + cycles, fn, context);
+}
+
+/**
+ * @brief Remove a pending event.
+ * @return TRUE if the event was still pending.
+ */
+int sched_cancel(int id) {
+    if (!heap_ready || id < 0 || id >= SCHED_MAX_EVENTS || heap_index[id] < 0) {
+        return FALSE;
+    }
+    heap_remove(heap_index[id]);
+    return TRUE;
+}
+
+/**
+ * @brief Clock ticks the CPU can run before the next event is due.
+ * @return 0 if an event is due now, otherwise the distance to the next event, at most limit.
+ */
+unsigned int sched_cycles_until_next(unsigned int limit) {
+    int distance;
+
+    if (sched_pending == 0) {
+        return limit;
+    }
+    distance = (int)(events[heap[0]].when - cpu_clock);
+    if (distance <= 0) {
+        return 0;
+    }
+    return (unsigned int)distance < limit ? (unsigned int)distance : limit;
+}
+
+/**
+ * @brief Clock value of the earliest pending event.
+ * @return FALSE if no event is pending.
+ */
+int sched_next_event(unsigned int* when) {
+    if (sched_pending == 0) {
+        return FALSE;
+    }
+    *when = events[heap[0]].when;
+    return TRUE;
+}
+
+/**
+ * @brief Call the callbacks of every event due at the current clock, earliest first.
+ * @details Events a callback posts for the current clock (or earlier) wait for the next
+ *          dispatch, so a device re-arming itself cannot keep this loop spinning.
+ */
+void sched_dispatch() {
+    unsigned int first_new = next_sequence;
+    SchedEvent event;
+
+    while (sched_pending && (int)(events[heap[0]].when - cpu_clock) <= 0 &&
+           (int)(events[heap[0]].sequence - first_new) < 0) {
+        event = events[heap[0]];
+        heap_remove(0);
+        event.fn(event.context, event.when);
+    }
+}
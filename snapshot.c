@@ -0,0 +1,176 @@
+/**
+ * @file snapshot.c
+ * @brief Capture, restore, save and load the complete machine state.
+ * @details A MachineState holds both memories, the register file, the PSW and the pipeline
+ *          registers, so a restored state continues on the very next CPU() call exactly as
+ *          the captured one would have. Snapshot files store the fields one by one (no struct
+ *          padding), after a magic string and a version number.
+ */
+
+#include "Emulator.h"
+
+/**
+ * @brief Copy the emulator globals into state.
+ */
+void state_capture(MachineState* state) {
+    memcpy(&state->imem, &imemory, sizeof(imemory));
+    memcpy(&state->dmem, &dmemory, sizeof(dmemory));
+    memcpy(state->dirty, dirty_pages, sizeof(state->dirty));
+    state_capture_registers(state);
+}
+
+/**
+ * @brief Copy state back into the emulator globals.
+ */
+void state_restore(const MachineState* state) {
+    memcpy(&imemory, &state->imem, sizeof(imemory));
+    memcpy(&dmemory, &state->dmem, sizeof(dmemory));
+    memcpy(dirty_pages, state->dirty, sizeof(dirty_pages));
+    state_restore_registers(state);
+}
+
+/**
+ * @brief Copy everything but the memories into state: registers, PSW, clock and pipeline.
+ */
+void state_capture_registers(MachineState* state) {
+    memcpy(state->regs, regfile[0], sizeof(state->regs));
+    state->psw = psw;
+    state->clock = cpu_clock;
+
+    state->imar = IMAR;
+    state->ir = IR;
+    state->imbr = IMBR;
+    state->ictrl = ICTRL;
+    state->ea = EA;
+    state->dmar = DMAR;
+    state->dmbr = DMBR;
+    state->dctrl = DCTRL;
+    state->mem_offset = offset;
+    state->mem_exec_stage = mem_exec_stage;
+    state->d_bubble = d_bubble;
+    state->e_bubble = e_bubble;
+    state->last_executed_address = last_executed_address;
+    state->skip_update = skip_update_last_executed_address;
+    state->cex_mask = cex_mask;
+    state->cex_count = cex_count;
+    state->operands = global_inst_operands;
+}
+
+/**
+ * @brief Copy everything but the memories back from state.
+ */
+void state_restore_registers(const MachineState* state) {
+    memcpy(regfile[0], state->regs, sizeof(state->regs));
+    psw = state->psw;
+    cpu_clock = state->clock;
+
+    IMAR = state->imar;
+    IR = state->ir;
+    IMBR = state->imbr;
+    ICTRL = state->ictrl;
+    EA = state->ea;
+    DMAR = state->dmar;
+    DMBR = state->dmbr;
+    DCTRL = state->dctrl;
+    offset = state->mem_offset;
+    mem_exec_stage = state->mem_exec_stage;
+    d_bubble = state->d_bubble;
+    e_bubble = state->e_bubble;
+    last_executed_address = state->last_executed_address;
+    skip_update_last_executed_address = state->skip_update;
+    cex_mask = state->cex_mask;
+    cex_count = state->cex_count;
+    global_inst_operands = state->operands;
+}
+
+/* Pipeline fields in file order; the decoded operands are rebuilt from their encoding on load */
+#define SNAPSHOT_FIELDS(FIELD)                                                   \
+    FIELD(clock) FIELD(imar) FIELD(ir) FIELD(imbr) FIELD(ictrl) FIELD(ea)        \
+    FIELD(dmar) FIELD(dmbr) FIELD(dctrl) FIELD(mem_offset) FIELD(mem_exec_stage) \
+    FIELD(d_bubble) FIELD(e_bubble) FIELD(last_executed_address) FIELD(skip_update) \
+    FIELD(cex_mask) FIELD(cex_count)
+
+/**
+ * @brief Write state to a snapshot file.
+ * @return TRUE on success.
+ */
+int state_save(const MachineState* state, const char* filename) {
+    FILE* out;
+    unsigned int version = SNAPSHOT_VERSION;
+    unsigned short psw_word, instruction, type, branch_offset;
+    int ok;
+
+    out = fopen(filename, "wb");
+    if (out == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+
+    memcpy(&psw_word, &state->psw, sizeof(psw_word));
+    instruction = state->operands.instruct_val;
+    type = (unsigned short)state->operands.instruction_type;
+    branch_offset = state->operands.branch_offset;
+
+    ok = fwrite(SNAPSHOT_MAGIC, 1, sizeof(SNAPSHOT_MAGIC) - 1, out) == sizeof(SNAPSHOT_MAGIC) - 1;
+    ok = ok && fwrite(&version, sizeof(version), 1, out) == 1;
+    ok = ok && fwrite(&state->imem, sizeof(state->imem), 1, out) == 1;
+    ok = ok && fwrite(&state->dmem, sizeof(state->dmem), 1, out) == 1;
+    ok = ok && fwrite(state->regs, sizeof(state->regs), 1, out) == 1;
+    ok = ok && fwrite(&psw_word, sizeof(psw_word), 1, out) == 1;
+#define WRITE_FIELD(name) ok = ok && fwrite(&state->name, sizeof(state->name), 1, out) == 1;
+    SNAPSHOT_FIELDS(WRITE_FIELD)
+#undef WRITE_FIELD
+    ok = ok && fwrite(&instruction, sizeof(instruction), 1, out) == 1;
+    ok = ok && fwrite(&type, sizeof(type), 1, out) == 1;
+    ok = ok && fwrite(&branch_offset, sizeof(branch_offset), 1, out) == 1;
+
+    if (fclose(out) != 0 || !ok) {
+        printf("Error writing snapshot >%s<\n\n", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Read a snapshot file written by state_save().
+ * @return TRUE on success.
+ */
+int state_load(MachineState* state, const char* filename) {
+    FILE* in;
+    char magic[sizeof(SNAPSHOT_MAGIC) - 1];
+    unsigned int version = 0;
+    unsigned short psw_word, instruction, type, branch_offset;
+    int ok;
+
+    in = fopen(filename, "rb");
+    if (in == NULL) {
+        printf("Error opening file >%s< - possibly missing.\n\n", filename);
+        return FALSE;
+    }
+
+    ok = fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    ok = ok && fread(&version, sizeof(version), 1, in) == 1 && version == SNAPSHOT_VERSION;
+    ok = ok && fread(&state->imem, sizeof(state->imem), 1, in) == 1;
+    ok = ok && fread(&state->dmem, sizeof(state->dmem), 1, in) == 1;
+    ok = ok && fread(state->regs, sizeof(state->regs), 1, in) == 1;
+    ok = ok && fread(&psw_word, sizeof(psw_word), 1, in) == 1;
+#define READ_FIELD(name) ok = ok && fread(&state->name, sizeof(state->name), 1, in) == 1;
+    SNAPSHOT_FIELDS(READ_FIELD)
+#undef READ_FIELD
+    ok = ok && fread(&instruction, sizeof(instruction), 1, in) == 1;
+    ok = ok && fread(&type, sizeof(type), 1, in) == 1;
+    ok = ok && fread(&branch_offset, sizeof(branch_offset), 1, in) == 1;
+    fclose(in);
+
+    if (!ok) {
+        printf("Error, >%s< is not an XM-23 snapshot (version %u)\n\n", filename, SNAPSHOT_VERSION);
+        return FALSE;
+    }
+
+    memcpy(&state->psw, &psw_word, sizeof(psw_word));
+    memset(state->dirty, 0xFF, sizeof(state->dirty)); // Nothing is known about the reset image
+    state->operands = extract_inst_operands(instruction);
+    state->operands.instruction_type = (enum instruct_table)type;
+    state->operands.branch_offset = branch_offset;
+    return TRUE;
+}
@@ -0,0 +1,475 @@
+/**
+ * @file state_diff.c
+ * @brief Compare two machine states and report what changed, and lockstep checking.
+ * @details Memories are compared 64 bytes at a time with AVX2 or SSE2 compare and movemask
+ *          (picked once at run time), falling back to 64-bit words elsewhere. Each block gives
+ *          a 64-bit mask of changed bytes, and only blocks with a change are turned into runs,
+ *          so comparing two identical 128 KB states costs a few microseconds. That makes it
+ *          cheap enough to compare every N slots in lockstep_run().
+ */
+
+#include "Emulator.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DIFF_X86 1
+#endif
+
+#define DIFF_BLOCK 64       // Bytes per compare block, one bit each in the block mask
+#define DIFF_SHOW_BYTES 16  // Bytes printed per changed run
+
+typedef struct {
+    DiffRun* runs;
+    int max_runs;
+    int count; // Runs found, max_runs + 1 once the list is full
+} DiffCollector;
+
+typedef int (*diff_scan_fn)(const unsigned char*, const unsigned char*, unsigned int, DiffCollector*);
+
+/**
+ * @brief Index of the lowest set bit of a non-zero mask.
+ */
+static unsigned int lowest_bit(unsigned long long mask) {
+#ifdef __GNUC__
+    return (unsigned int)__builtin_ctzll(mask);
+#else
+    unsigned int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * @brief Turn the changed-byte mask of one block into runs, merging with the previous run.
+ * @return FALSE once max_runs is exceeded and scanning can stop.
+ */
+static int diff_collect(DiffCollector* col, unsigned int base, unsigned long long mask) {
+    while (mask) {
+        unsigned int bit = lowest_bit(mask);
+        unsigned long long rest = ~(mask >> bit);
+        unsigned int length = rest ? lowest_bit(rest) : DIFF_BLOCK - bit;
+        DiffRun* last = col->count ? &col->runs[col->count - 1] : NULL;
+
+        if (last != NULL && col->count <= col->max_runs && last->start + last->length == base + bit) {
+            last->length += length; // Continues a run from the previous block
+        }
+        else if (col->count < col->max_runs) {
+            col->runs[col->count].start = base + bit;
+            col->runs[col->count].length = length;
+            col->count++;
+        }
+        else {
+            col->count = col->max_runs + 1;
+            return FALSE;
+        }
+
+        mask = (bit + length >= DIFF_BLOCK) ? 0 : mask & ~((1ULL << (bit + length)) - 1);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Portable scan, 64-bit words at a time.
+ */
+static int diff_scan_words(const unsigned char* a, const unsigned char* b, unsigned int length, DiffCollector* col) {
+    unsigned int base, i;
+    unsigned long long wa, wb, mask;
+
+    for (base = 0; base < length; base += DIFF_BLOCK) {
+        mask = 0;
+        for (i = 0; i < DIFF_BLOCK; i += 8) {
+            memcpy(&wa, a + base + i, 8);
+            memcpy(&wb, b + base + i, 8);
+            if (wa != wb) {
+                unsigned int byte_index;
+                for (byte_index = 0; byte_index < 8; byte_index++) {
+                    if (a[base + i + byte_index] != b[base + i + byte_index]) {
+                        mask |= 1ULL << (i + byte_index);
+                    }
+                }
+            }
+        }
+        if (mask && !diff_collect(col, base, mask)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+#ifdef DIFF_X86
+/**
+ * @brief SSE2 scan, four 16-byte compares per block.
+ */
+__attribute__((target("sse2")))
+static int diff_scan_sse2(const unsigned char* a, const unsigned char* b, unsigned int length, DiffCollector* col) {
+    unsigned int base, i;
+    unsigned long long equal;
+
+    for (base = 0; base < length; base += DIFF_BLOCK) {
+        equal = 0;
+        for (i = 0; i < DIFF_BLOCK; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + base + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + base + i));
+            equal |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) << i;
+        }
+        if (~equal && !diff_collect(col, base, ~equal)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief AVX2 scan, two 32-byte compares per block.
+ */
+__attribute__((target("avx2")))
+static int diff_scan_avx2(const unsigned char* a, const unsigned char* b, unsigned int length, DiffCollector* col) {
+    unsigned int base;
+    unsigned long long equal;
+
+    for (base = 0; base < length; base += DIFF_BLOCK) {
+        __m256i lo = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + base)),
+                                       _mm256_loadu_si256((const __m256i*)(b + base)));
+        __m256i hi = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + base + 32)),
+                                       _mm256_loadu_si256((const __m256i*)(b + base + 32)));
+        equal = (unsigned int)_mm256_movemask_epi8(lo) | ((unsigned long long)(unsigned int)_mm256_movemask_epi8(hi) << 32);
+        if (~equal && !diff_collect(col, base, ~equal)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+#endif
+
+/**
+ * @brief Pick the widest compare the host supports, once.
+ */
+static diff_scan_fn diff_select_scan() {
+    static diff_scan_fn scan = NULL;
+
+    if (scan == NULL) {
+        scan = diff_scan_words;
+#ifdef DIFF_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            scan = diff_scan_avx2;
+        }
+        else if (__builtin_cpu_supports("sse2")) {
+            scan = diff_scan_sse2;
+        }
+#endif
+    }
+    return scan;
+}
+
+/**
+ * @brief Find the runs of bytes that differ between two buffers.
+ * @param length Buffer length, a multiple of 64.
+ * @param runs Receives at most max_runs runs, in address order.
+ * @return Number of runs stored, or max_runs + 1 if there are more (0 means equal).
+ */
+int diff_memory(const unsigned char* before, const unsigned char* after, unsigned int length, DiffRun* runs, int max_runs) {
+    DiffCollector col;
+
+    col.runs = runs;
+    col.max_runs = max_runs;
+    col.count = 0;
+    diff_select_scan()(before, after, length, &col);
+    return col.count;
+}
+
+/**
+ * @brief Print one memory's changed runs with their before and after bytes.
+ * @return Number of runs found.
+ */
+static int print_memory_diff(const char* name, const unsigned char* before, const unsigned char* after) {
+    static DiffRun runs[DIFF_MAX_RUNS];
+    int count, run;
+    unsigned int i;
+
+    count = diff_memory(before, after, BTMEMSIZE, runs, DIFF_MAX_RUNS);
+    if (count == 0) {
+        return 0;
+    }
+
+    printf("%s: %d%s changed range(s)\n", name, count > DIFF_MAX_RUNS ? DIFF_MAX_RUNS : count,
+        count > DIFF_MAX_RUNS ? "+" : "");
+    for (run = 0; run < count && run < DIFF_MAX_RUNS; run++) {
+        printf("  %04X-%04X (%u byte%s)\n    before:", runs[run].start, runs[run].start + runs[run].length - 1,
+            runs[run].length, runs[run].length == 1 ? "" : "s");
+        for (i = 0; i < runs[run].length && i < DIFF_SHOW_BYTES; i++) {
+            printf(" %02X", before[runs[run].start + i]);
+        }
+        printf("%s\n    after: ", runs[run].length > DIFF_SHOW_BYTES ? " ..." : "");
+        for (i = 0; i < runs[run].length && i < DIFF_SHOW_BYTES; i++) {
+            printf(" %02X", after[runs[run].start + i]);
+        }
+        printf("%s\n", runs[run].length > DIFF_SHOW_BYTES ? " ..." : "");
+    }
+    return count;
+}
+
+/**
+ * @brief Print every difference between two machine states.
+ * @return Number of differences (changed memory runs, registers, PSW bits and pipeline fields).
+ */
+int state_diff(const MachineState* before, const MachineState* after) {
+    static const char* reg_names[NUM_REG_OR_CONS] = { "R0", "R1", "R2", "R3", "R4 (BP)", "R5 (LR)", "R6 (SP)", "R7 (PC)" };
+    int differences = 0;
+    int reg;
+
+    differences += print_memory_diff("Instruction memory", before->imem.btmem, after->imem.btmem);
+    differences += print_memory_diff("Data memory", before->dmem.btmem, after->dmem.btmem);
+
+    for (reg = 0; reg < NUM_REG_OR_CONS; reg++) {
+        if (before->regs[reg] != after->regs[reg]) {
+            printf("%s: %04X -> %04X\n", reg_names[reg], before->regs[reg], after->regs[reg]);
+            differences++;
+        }
+    }
+
+#define DIFF_PSW_BIT(name, label)                                                              \
+    if (before->psw.name != after->psw.name) {                                                 \
+        printf("PSW %s: %d -> %d\n", label, before->psw.name, after->psw.name);                \
+        differences++;                                                                         \
+    }
+    DIFF_PSW_BIT(c, "C") DIFF_PSW_BIT(z, "Z") DIFF_PSW_BIT(n, "N") DIFF_PSW_BIT(slp, "SLP") DIFF_PSW_BIT(v, "V")
+    DIFF_PSW_BIT(current, "current priority") DIFF_PSW_BIT(faulting, "faulting") DIFF_PSW_BIT(previous, "previous priority")
+#undef DIFF_PSW_BIT
+
+#define DIFF_FIELD(name, label)                                                                \
+    if (before->name != after->name) {                                                         \
+        printf("%s: %04X -> %04X\n", label, (unsigned int)before->name, (unsigned int)after->name); \
+        differences++;                                                                         \
+    }
+    if (before->clock != after->clock) {
+        printf("Clock: %u -> %u\n", before->clock, after->clock);
+        differences++;
+    }
+    DIFF_FIELD(imar, "IMAR") DIFF_FIELD(ir, "IR") DIFF_FIELD(dmar, "DMAR")
+    DIFF_FIELD(dctrl, "DCTRL") DIFF_FIELD(mem_exec_stage, "E1 pending") DIFF_FIELD(d_bubble, "Decode bubble")
+    DIFF_FIELD(e_bubble, "Execute bubble") DIFF_FIELD(last_executed_address, "Last executed address")
+    DIFF_FIELD(operands.instruct_val, "Instruction in execute")
+    DIFF_FIELD(cex_count, "CEX instructions left") DIFF_FIELD(cex_mask, "CEX predicate")
+#undef DIFF_FIELD
+
+    return differences;
+}
+
+/**
+ * @brief Check two states for equality without printing, stopping at the first difference.
+ */
+int state_equal(const MachineState* a, const MachineState* b) {
+    return a->clock == b->clock && a->imar == b->imar && a->ir == b->ir &&
+        a->mem_exec_stage == b->mem_exec_stage && a->d_bubble == b->d_bubble && a->e_bubble == b->e_bubble &&
+        a->last_executed_address == b->last_executed_address && a->operands.instruct_val == b->operands.instruct_val &&
+        a->cex_count == b->cex_count && a->cex_mask == b->cex_mask &&
+        (!a->mem_exec_stage || (a->dmar == b->dmar && a->dctrl == b->dctrl)) &&
+        memcmp(a->regs, b->regs, sizeof(a->regs)) == 0 && memcmp(&a->psw, &b->psw, sizeof(a->psw)) == 0 &&
+        diff_memory(a->dmem.btmem, b->dmem.btmem, BTMEMSIZE, NULL, 0) == 0 &&
+        diff_memory(a->imem.btmem, b->imem.btmem, BTMEMSIZE, NULL, 0) == 0;
+}
+
+/**
+ * @brief Run CPU() up to the first slot boundary at or after clock target.
+ */
+static void run_reference(unsigned int slots) {
+    unsigned int target;
+
+    // Same alignment as CPU_fused(): finish a partial slot before counting
+    while (program_running && ((cpu_clock & 1) || d_bubble != e_bubble || cpu_clock == 0)) {
+        CPU();
+    }
+    target = cpu_clock + 2 * slots;
+    while (program_running && ((int)(cpu_clock - target) < 0 || (cpu_clock & 1) || d_bubble != e_bubble)) {
+        CPU();
+    }
+}
+
+/**
+ * @brief Run the program twice in lockstep, through CPU() and through CPU_fused(),
+ *        comparing the two machine states every interval slots.
+ * @details An interval ends early at the next scheduled event. Between intervals the run
+ *          goes on as in run_xm_continuous(): due events are dispatched and idle_skip()
+ *          skips idle and countdown loops, stopping the check at a branch to itself.
+ * @return TRUE if the runs diverged or the check was stopped by ^C.
+ */
+int lockstep_run(unsigned int interval) {
+    static MachineState reference, fused;
+    int reference_running, fused_running;
+    int saved_trace = trace_enabled;
+    int saved_coverage = coverage_enabled;
+    int saved_heatmap = heatmap_enabled;
+    unsigned long long slots = 0;
+    unsigned int clock_before, run;
+    int stopped = FALSE;
+    int dispatched;
+
+    trace_enabled = FALSE; // Both runs must be quiet, CPU_fused() never prints
+    ctrl_c_fnd = FALSE;
+    state_capture(&fused);
+
+    while (program_running) {
+        clock_before = fused.clock;
+        run = sched_cycles_until_next(2 * interval) / 2;
+        if (run == 0) { // An event is due within the slot, it is dispatched one slot late
+            run = 1;
+        }
+
+        run_reference(run);
+        reference_running = program_running;
+        state_capture(&reference);
+
+        state_restore(&fused);
+        program_running = TRUE;
+        coverage_enabled = FALSE; // Coverage and the heatmap count the reference run only
+        heatmap_enabled = FALSE;
+        CPU_fused(run);
+        coverage_enabled = saved_coverage;
+        heatmap_enabled = saved_heatmap;
+        fused_running = program_running;
+        state_capture(&fused);
+
+        slots += run;
+        if (reference_running != fused_running || !state_equal(&reference, &fused)) {
+            printf("Lockstep runs diverged between clock %u and %u (reference -> fused):\n", clock_before, reference.clock);
+            if (reference_running != fused_running) {
+                printf("Running: %d -> %d\n", reference_running, fused_running);
+            }
+            state_diff(&reference, &fused);
+            state_restore(&reference); // Continue from the reference run
+            stopped = TRUE;
+            break;
+        }
+        program_running = reference_running;
+
+        // Both runs are at this state; the next interval starts from it once the events are done
+        dispatched = sched_cycles_until_next(1) == 0;
+        if (dispatched) {
+            sched_dispatch();
+        }
+        if (program_running && idle_skip_allowed()) {
+            idle_skip();
+        }
+        if (dispatched || cpu_clock != fused.clock) {
+            state_capture(&fused);
+        }
+        if (ctrl_c_fnd) {
+            ctrl_c_fnd = FALSE;
+            stopped = TRUE;
+            break;
+        }
+    }
+
+    trace_enabled = saved_trace;
+    printf("Lockstep checked about %llu slots every %u, clock %u%s\n\n", slots, interval, cpu_clock,
+        stopped ? "" : ", no divergence");
+    return stopped;
+}
+
+/**
+ * @brief Interactive submenu to save, compare and lockstep-check machine states.
+ */
+void state_diff_menu() {
+    static MachineState current, loaded, other, checkpoint;
+    static int checkpoint_taken = FALSE;
+    int pages;
+    char user_choice;
+    char filename[BUFFER_LEN], second[BUFFER_LEN];
+    unsigned int interval;
+    int ch;
+
+    printf("\nPress and enter S -> to Save the machine state to a snapshot file\n");
+    printf("Press and enter C -> to Compare the machine state with a snapshot file\n");
+    printf("Press and enter F -> to Compare two snapshot files\n");
+    printf("Press and enter L -> to Run in lockstep, checking CPU() against the fused loop\n");
+    printf("Press and enter R -> to Reset the machine to its state when the program was loaded\n");
+    printf("Press and enter K -> to Keep a checkpoint of the machine state, J -> to Jump back to it\n");
+    printf("Enter option here ==> ");
+    (void)scanf(" %c", &user_choice);
+    while ((ch = getchar()) != '\n' && ch != EOF);
+
+    switch (user_choice) {
+    case 'S':
+    case 's':
+        printf("Enter the snapshot file name: ");
+        if (scanf("%255s", filename) == 1) {
+            state_capture(&current);
+            if (state_save(&current, filename)) {
+                printf("Machine state saved to %s\n\n", filename);
+            }
+        }
+        break;
+    case 'C':
+    case 'c':
+        printf("Enter the snapshot file name: ");
+        if (scanf("%255s", filename) == 1 && state_load(&loaded, filename)) {
+            state_capture(&current);
+            if (state_diff(&loaded, &current) == 0) {
+                printf("No differences.\n");
+            }
+            printf("\n");
+        }
+        break;
+    case 'F':
+    case 'f':
+        printf("Enter the two snapshot file names (before after): ");
+        if (scanf("%255s %255s", filename, second) == 2 && state_load(&loaded, filename) && state_load(&other, second)) {
+            if (state_diff(&loaded, &other) == 0) {
+                printf("No differences.\n");
+            }
+            printf("\n");
+        }
+        break;
+    case 'L':
+    case 'l':
+        printf("Enter the number of instruction slots between comparisons: ");
+        if (scanf("%u", &interval) != 1 || interval == 0) {
+            printf("Invalid interval.\n\n");
+        }
+        else {
+            program_running = TRUE;
+            lockstep_run(interval);
+            program_running = TRUE; // Keep the menu active
+        }
+        break;
+    case 'R':
+    case 'r':
+        pages = reset_to_image();
+        if (pages < 0) {
+            printf("No program has been loaded.\n\n");
+        }
+        else {
+            printf("Machine reset to the loaded program, %d page(s) restored.\n\n", pages);
+        }
+        return; // The line was read with the option
+    case 'K':
+    case 'k':
+        pages = checkpoint_capture(&checkpoint);
+        if (pages < 0) {
+            printf("No program has been loaded.\n\n");
+        }
+        else {
+            checkpoint_taken = TRUE;
+            printf("Checkpoint taken at clock %u, %d dirty page(s) copied.\n\n", cpu_clock, pages);
+        }
+        return;
+    case 'J':
+    case 'j':
+        if (!checkpoint_taken) {
+            printf("No checkpoint has been taken.\n\n");
+        }
+        else {
+            pages = checkpoint_restore(&checkpoint);
+            printf("Back at the checkpoint, clock %u, %d page(s) restored.\n\n", cpu_clock, pages);
+        }
+        return;
+    default:
+        printf("Invalid option.\n\n");
+        return;
+    }
+    while ((ch = getchar()) != '\n' && ch != EOF);
+}
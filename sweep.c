@@ -0,0 +1,353 @@
+/**
+ * @file sweep.c
+ * @brief Parameter sweeps: the loaded program run under a grid of timing models, in parallel.
+ * @details A grid file holds timing settings (see timing.c) and axes. A setting applies to
+ *          every point of the grid, on top of the -T model if one was given. An axis is a
+ *          setting with its value left out, then a colon and the values to try:
+ *
+ *              imem 1                  # every point
+ *              dmem : 0 1 2 4          # four D-memory wait states
+ *              imem 8000 FFFF : 1 8    # times two wait states of a slow region
+ *              branch_taken : 0 1 2
+ *
+ *          The grid is every combination of the axis values, the first axis varying slowest.
+ *          Worker threads take points in turn. The machine as loaded is captured once and
+ *          only read by the workers: each restores it into its own thread-local machine, and
+ *          after a point goes back to it through reset_to_image(), copying just the pages the
+ *          point wrote. The results end up in one table in grid order. Cycles are machine
+ *          cycles, two clock ticks each, as in the timing report.
+ */
+
+#include "Emulator.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SWEEP_VALUE_LEN 16
+
+typedef struct {
+    char setting[BUFFER_LEN]; // The setting the values complete, e.g. "imem 8000 FFFF"
+    char values[SWEEP_MAX_VALUES][SWEEP_VALUE_LEN];
+    int count;
+} SweepAxis;
+
+typedef struct {
+    unsigned int clock;
+    unsigned short stop_address;
+    int limit_reached;
+    int done;
+    TimingCounters counts;
+} SweepResult;
+
+static TimingConfig sweep_base; // Settings shared by every point
+static SweepAxis axes[SWEEP_MAX_AXES];
+static int axis_count;
+static int point_count;
+static SweepResult* results;
+static MachineState* sweep_image; // The loaded machine, read by every worker
+static unsigned short sweep_breakpoint;
+static int sweep_breakpoint_set;
+static unsigned int sweep_limit;
+static int next_point;
+static pthread_mutex_t next_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Apply value of axis to config.
+ * @return FALSE if the resulting setting is not understood.
+ */
+static int sweep_apply(TimingConfig* config, const SweepAxis* axis, const char* value) {
+    char line[BUFFER_LEN * 2];
+
+    snprintf(line, sizeof(line), "%s %s", axis->setting, value);
+    return timing_setting(config, line);
+}
+
+/**
+ * @brief Read the grid file into sweep_base and axes.
+ * @return FALSE if the file cannot be read or describes no valid grid.
+ */
+static int sweep_parse(const char* filename) {
+    static TimingConfig scratch; // Checks every axis value once, before any run
+    FILE* in = fopen(filename, "r");
+    char line[BUFFER_LEN];
+    char* colon;
+    char* value;
+    SweepAxis* axis;
+    int line_number = 0;
+
+    if (in == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    axis_count = 0;
+    point_count = 1;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line_number++;
+        if (strchr(line, '#') != NULL) {
+            *strchr(line, '#') = '\0';
+        }
+        colon = strchr(line, ':');
+        if (colon == NULL) {
+            if (!timing_setting(&sweep_base, line)) {
+                printf("%s:%d: not a timing setting\n", filename, line_number);
+                fclose(in);
+                return FALSE;
+            }
+            continue;
+        }
+
+        if (axis_count == SWEEP_MAX_AXES) {
+            printf("%s:%d: at most %d axes\n", filename, line_number, SWEEP_MAX_AXES);
+            fclose(in);
+            return FALSE;
+        }
+        axis = &axes[axis_count];
+        *colon = '\0';
+        if (sscanf(line, " %255[^\n]", axis->setting) != 1) {
+            axis->setting[0] = '\0';
+        }
+        while (axis->setting[0] != '\0' && isspace((unsigned char)axis->setting[strlen(axis->setting) - 1])) {
+            axis->setting[strlen(axis->setting) - 1] = '\0';
+        }
+        axis->count = 0;
+        for (value = strtok(colon + 1, " \t\r\n"); value != NULL; value = strtok(NULL, " \t\r\n")) {
+            if (axis->count == SWEEP_MAX_VALUES || strlen(value) >= SWEEP_VALUE_LEN || !sweep_apply(&scratch, axis, value)) {
+                printf("%s:%d: %s is not a value of \"%s\" (at most %d values)\n", filename, line_number, value,
+                    axis->setting, SWEEP_MAX_VALUES);
+                fclose(in);
+                return FALSE;
+            }
+            strcpy(axis->values[axis->count++], value);
+        }
+        if (axis->count == 0) {
+            printf("%s:%d: the axis has no values\n", filename, line_number);
+            fclose(in);
+            return FALSE;
+        }
+        point_count *= axis->count;
+        if (point_count > SWEEP_MAX_POINTS) {
+            printf("%s:%d: the grid has more than %d points\n", filename, line_number, SWEEP_MAX_POINTS);
+            fclose(in);
+            return FALSE;
+        }
+        axis_count++;
+    }
+    fclose(in);
+    return TRUE;
+}
+
+/**
+ * @brief Index of the value axis takes at point.
+ */
+static int sweep_value(int point, int axis) {
+    int n;
+
+    for (n = axis_count - 1; n > axis; n--) {
+        point /= axes[n].count;
+    }
+    return point % axes[axis].count;
+}
+
+/**
+ * @brief Scheduled at the cycle limit of a point.
+ */
+static void sweep_limit_reached(void* context, unsigned int when) {
+    (void)when;
+    ((SweepResult*)context)->limit_reached = TRUE;
+    program_running = FALSE;
+}
+
+/**
+ * @brief Run the calling thread's machine until it stops, as run_xm_continuous() does.
+ * @details The timing model keeps every tick in CPU(), and idle_skip() skips idle and
+ *          countdown loops as it does there. ^C stops every worker, so it is left set for the
+ *          others to see.
+ */
+static void sweep_point(SweepResult* result) {
+    unsigned int cycles, target;
+    int limit_event = -1;
+
+    sched_clear();
+    if (sweep_limit) {
+        limit_event = sched_post(sweep_limit, sweep_limit_reached, result);
+    }
+    program_running = TRUE;
+    while (program_running && !ctrl_c_fnd) {
+        cycles = sched_cycles_until_next(RUN_BATCH);
+        target = cpu_clock + cycles;
+        while (program_running && (int)(cpu_clock - target) < 0) {
+            CPU();
+        }
+        sched_dispatch();
+        idle_skip(); // Also stops a point that ends in a branch to itself
+    }
+    if (limit_event >= 0 && !result->limit_reached) {
+        sched_cancel(limit_event);
+    }
+    result->clock = cpu_clock;
+    result->stop_address = last_executed_address;
+    result->counts = timing_counts;
+    result->done = !ctrl_c_fnd;
+}
+
+/**
+ * @brief Next point to run, or -1 when there are none left or ^C was pressed.
+ */
+static int sweep_next() {
+    int point = -1;
+
+    pthread_mutex_lock(&next_lock);
+    if (next_point < point_count && !ctrl_c_fnd) {
+        point = next_point++;
+    }
+    pthread_mutex_unlock(&next_lock);
+    return point;
+}
+
+/**
+ * @brief Worker thread: restore the image once, then run points until none are left.
+ */
+static void* sweep_worker(void* arg) {
+    TimingConfig* config = malloc(sizeof(*config));
+    int point, axis;
+#ifdef DEBUG
+    DiagnosticInfo ring[diagnostic_ring]; // The trace is off during a sweep, CPU() only needs somewhere to write
+
+    diagnostics = ring;
+    diagnostic_size = diagnostic_ring;
+    diag_index = 0;
+#endif
+
+    (void)arg;
+    if (config == NULL) {
+        printf("Sweep worker: out of memory\n");
+        return NULL;
+    }
+    state_restore(sweep_image);
+    reset_image = sweep_image;
+    memset(dirty_pages, 0, sizeof(dirty_pages)); // The memories are the image's
+    breakpoint_address = sweep_breakpoint;
+    breakpoint_set = sweep_breakpoint_set;
+
+    while ((point = sweep_next()) >= 0) {
+        *config = sweep_base;
+        for (axis = 0; axis < axis_count; axis++) {
+            sweep_apply(config, &axes[axis], axes[axis].values[sweep_value(point, axis)]);
+        }
+        timing_set(config);
+        sweep_point(&results[point]);
+        reset_to_image();
+    }
+
+    free(config);
+    return NULL;
+}
+
+/**
+ * @brief Print the results in grid order, one line per point.
+ */
+static void sweep_report() {
+    const SweepResult* result;
+    double cycles;
+    int point, axis, width;
+
+    printf("%5s", "Point");
+    for (axis = 0; axis < axis_count; axis++) {
+        printf("  %6s", axes[axis].setting);
+    }
+    printf("  %12s  %12s  %6s  %10s  %10s  %10s  %10s  %s\n", "Cycles", "Instructions", "IPC", "Fetch", "Data",
+        "Execute", "Branch", "Stopped");
+
+    for (point = 0; point < point_count; point++) {
+        result = &results[point];
+        printf("%5d", point);
+        for (axis = 0; axis < axis_count; axis++) {
+            width = strlen(axes[axis].setting) > 6 ? (int)strlen(axes[axis].setting) : 6;
+            printf("  %*s", width, axes[axis].values[sweep_value(point, axis)]);
+        }
+        if (!result->done) {
+            printf("  not run\n");
+            continue;
+        }
+        cycles = result->clock / 2.0;
+        printf("  %12.0f  %12u  %6.3f  %10u  %10u  %10u  %10u  %04X%s\n", cycles, result->counts.instructions,
+            cycles > 0 ? result->counts.instructions / cycles : 0.0, result->counts.fetch, result->counts.data,
+            result->counts.execute, result->counts.branch, result->stop_address,
+            result->limit_reached ? " (cycle limit)" : "");
+    }
+}
+
+/**
+ * @brief Run the loaded program at every point of the grid in filename, then print the table.
+ * @param threads Worker threads, 0 for one per online host CPU.
+ * @param cycle_limit Clock value each point stops at, 0 for no limit.
+ * @details Each point starts from the machine as it is now, with its breakpoint.
+ * @return FALSE if the grid cannot be run or the sweep was interrupted by ^C.
+ */
+int sweep_run(const char* filename, int threads, unsigned int cycle_limit) {
+    pthread_t workers[SWEEP_MAX_THREADS];
+    struct timespec start, end;
+    int saved_trace = trace_enabled;
+    int started, n;
+
+    if (timing_active) { // A -T model is the starting point of every point
+        sweep_base = timing;
+    }
+    else {
+        memset(&sweep_base, 0, sizeof(sweep_base));
+    }
+    if (!sweep_parse(filename)) {
+        return FALSE;
+    }
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > point_count) {
+        threads = point_count;
+    }
+    if (threads > SWEEP_MAX_THREADS) {
+        threads = SWEEP_MAX_THREADS;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    sweep_image = malloc(sizeof(*sweep_image));
+    results = calloc((size_t)point_count, sizeof(*results));
+    if (sweep_image == NULL || results == NULL) {
+        printf("Out of memory for the sweep\n");
+        free(sweep_image);
+        free(results);
+        return FALSE;
+    }
+    state_capture(sweep_image);
+    sweep_breakpoint = breakpoint_address;
+    sweep_breakpoint_set = breakpoint_set;
+    sweep_limit = cycle_limit;
+    next_point = 0;
+    trace_enabled = FALSE; // Workers on several threads cannot share the trace
+    ctrl_c_fnd = FALSE;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (started = 0; started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, sweep_worker, NULL) != 0) {
+            printf("Could not start sweep worker %d\n", started);
+            break;
+        }
+    }
+    for (n = 0; n < started; n++) {
+        pthread_join(workers[n], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    trace_enabled = saved_trace;
+
+    printf("%d configurations on %d threads in %.2f s%s\n", point_count, started,
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, ctrl_c_fnd ? " (interrupted)" : "");
+    sweep_report();
+    free(sweep_image);
+    free(results);
+    n = started > 0 && !ctrl_c_fnd;
+    ctrl_c_fnd = FALSE;
+    return n;
+}
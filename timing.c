@@ -0,0 +1,244 @@
+/**
+ * @file timing.c
+ * @brief Configurable timing model: memory wait states, execute latencies and branch penalties.
+ * @details The default machine takes one cycle (two clock half-cycles) per instruction slot.
+ *          A timing file describes a slower machine, and while one is loaded CPU() adds its
+ *          stalls to cpu_clock: the wait states of the I-memory word fetched by F0, those of
+ *          the D-memory word accessed by E1, the extra execute cycles of each instruction type
+ *          in E0, and the penalty of a taken or not-taken branch. Stalls are whole cycles, so
+ *          the pipeline keeps its even/odd tick pairing. Wait states are expanded per word
+ *          when the file is loaded, so a region costs nothing at run time. Without a timing
+ *          file timing_active is clear, the fused loop runs as before and CPU() pays one test
+ *          per tick; with one, runs go through CPU(), and idle_skip() still skips idle and
+ *          countdown loops by the period it measures, stalls included.
+ *
+ *          The file holds one setting per line, # starting a comment, values in cycles and
+ *          addresses in hexadecimal:
+ *
+ *              imem <cycles>                   wait states of every instruction fetch
+ *              imem <start> <end> <cycles>     of the fetches from start..end (inclusive)
+ *              dmem <cycles>                   wait states of every LD/ST/LDR/STR access
+ *              dmem <start> <end> <cycles>     of the accesses to start..end
+ *              latency <instruction> <cycles>  extra execute cycles, e.g. latency DADD 1
+ *              branch_taken <cycles>           penalty of a taken branch or BL
+ *              branch_not_taken <cycles>       penalty of a conditional branch that falls through
+ *
+ *          Later lines override earlier ones, so a region follows the default it refines.
+ */
+
+#include "Emulator.h"
+#include <strings.h>
+
+XM_CORE int timing_active = FALSE;
+XM_CORE TimingConfig timing;
+XM_CORE TimingCounters timing_counts;
+static XM_CORE char timing_file[BUFFER_LEN]; // The file the model came from, for the menu
+
+/* Names of enum instruct_table, as used by latency lines */
+static const char* type_names[TIMING_TYPES] = {
+    "BL", "BEQ", "BNE", "BC", "BNC", "BN", "BGE", "BLT", "BRA",
+    "ADD", "ADDC", "SUB", "SUBC", "DADD", "CMP", "XOR", "AND", "OR", "BIT", "BIC", "BIS", "MOV", "SWAP",
+    "SRA", "RRC", "SWPB", "SXT", "SETPRI", "SVC", "SETCC", "CLRCC", "CEX", "LD", "ST",
+    "MOVL", "MOVLZ", "MOVLS", "MOVH", "LDR", "STR"
+};
+
+/**
+ * @brief Stall of the F0 fetch from address, in clock ticks.
+ */
+unsigned int timing_fetch(unsigned short address) {
+    unsigned int ticks = timing.fetch[address >> 1];
+
+    timing_counts.fetch += ticks >> 1;
+    return ticks;
+}
+
+/**
+ * @brief Stall of the E1 access to address, in clock ticks.
+ */
+unsigned int timing_data(unsigned short address) {
+    unsigned int ticks = timing.data[address >> 1];
+
+    timing_counts.data += ticks >> 1;
+    return ticks;
+}
+
+/**
+ * @brief Stall of the instruction E0 has just executed, in clock ticks.
+ * @details A bubble costs nothing and is not counted; a predicated-off CEX instruction takes
+ *          its slot but not its latency. d_bubble is only raised by a taken branch.
+ */
+unsigned int timing_execute() {
+    enum instruct_table type = global_inst_operands.instruction_type;
+    unsigned int ticks, penalty;
+
+    if (skip_update_last_executed_address) {
+        return 0;
+    }
+    timing_counts.instructions++;
+    if (cex_skipped) {
+        return 0;
+    }
+    ticks = timing.latency[type];
+    timing_counts.execute += ticks >> 1;
+    if (type <= BRA_EXEC) {
+        penalty = d_bubble ? timing.branch_taken : timing.branch_not_taken;
+        timing_counts.branch += penalty >> 1;
+        ticks += penalty;
+    }
+    return ticks;
+}
+
+/**
+ * @brief Set the wait states of a word range of table, in ticks.
+ */
+static void set_waits(unsigned char* table, unsigned int start, unsigned int end, unsigned int cycles) {
+    unsigned int word;
+
+    for (word = start >> 1; word <= end >> 1 && word < WDMEMSIZE; word++) {
+        table[word] = (unsigned char)(cycles << 1);
+    }
+}
+
+/**
+ * @brief Apply one line of a timing file to config; the line may be changed.
+ * @return FALSE if the line is not understood.
+ */
+int timing_setting(TimingConfig* config, char* line) {
+    char key[BUFFER_LEN], name[BUFFER_LEN];
+    unsigned int start, end, cycles;
+    int type, fields;
+
+    if (strchr(line, '#') != NULL) {
+        *strchr(line, '#') = '\0';
+    }
+    if (sscanf(line, "%255s", key) != 1) {
+        return TRUE; // Blank line
+    }
+    if (strcmp(key, "imem") == 0 || strcmp(key, "dmem") == 0) {
+        unsigned char* table = key[0] == 'i' ? config->fetch : config->data;
+        fields = sscanf(line, "%*s %x %x %u", &start, &end, &cycles);
+        if (fields == 1) { // The default, in decimal like every other count
+            sscanf(line, "%*s %u", &cycles);
+            start = 0;
+            end = BTMEMSIZE - 1;
+        }
+        else if (fields != 3 || start > end || end >= BTMEMSIZE) {
+            return FALSE;
+        }
+        if (cycles > TIMING_MAX_CYCLES) {
+            return FALSE;
+        }
+        set_waits(table, start, end, cycles);
+        return TRUE;
+    }
+    if (strcmp(key, "latency") == 0) {
+        if (sscanf(line, "%*s %255s %u", name, &cycles) != 2 || cycles > TIMING_MAX_CYCLES) {
+            return FALSE;
+        }
+        for (type = 0; type < TIMING_TYPES && strcasecmp(name, type_names[type]) != 0; type++);
+        if (type == TIMING_TYPES) {
+            return FALSE;
+        }
+        config->latency[type] = (unsigned char)(cycles << 1);
+        return TRUE;
+    }
+    if (strcmp(key, "branch_taken") == 0 || strcmp(key, "branch_not_taken") == 0) {
+        if (sscanf(line, "%*s %u", &cycles) != 1 || cycles > TIMING_MAX_CYCLES) {
+            return FALSE;
+        }
+        *(strcmp(key, "branch_taken") == 0 ? &config->branch_taken : &config->branch_not_taken) = (unsigned char)(cycles << 1);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Read a timing file into config, starting from the default machine.
+ * @return FALSE if the file cannot be read or has a line that is not understood.
+ */
+int timing_parse(TimingConfig* config, const char* filename) {
+    FILE* in = fopen(filename, "r");
+    char line[BUFFER_LEN];
+    int line_number = 0;
+
+    if (in == NULL) {
+        printf("Error opening file >%s<\n\n", filename);
+        return FALSE;
+    }
+    memset(config, 0, sizeof(*config));
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line_number++;
+        if (!timing_setting(config, line)) {
+            printf("%s:%d: not a timing setting (cycles go up to %d)\n", filename, line_number, TIMING_MAX_CYCLES);
+            fclose(in);
+            return FALSE;
+        }
+    }
+    fclose(in);
+    return TRUE;
+}
+
+/**
+ * @brief Make config the timing of this thread's machine, or go back to the default with NULL.
+ */
+void timing_set(const TimingConfig* config) {
+    if (config == NULL) {
+        timing_active = FALSE;
+        memset(&timing, 0, sizeof(timing));
+    }
+    else {
+        timing = *config;
+        timing_active = TRUE;
+    }
+    memset(&timing_counts, 0, sizeof(timing_counts));
+}
+
+/**
+ * @brief Load a timing file as the timing of this thread's machine.
+ * @return FALSE, keeping the current timing, if the file cannot be used.
+ */
+int timing_load(const char* filename) {
+    static TimingConfig config;
+
+    if (!timing_parse(&config, filename)) {
+        return FALSE;
+    }
+    timing_set(&config);
+    snprintf(timing_file, sizeof(timing_file), "%s", filename);
+    return TRUE;
+}
+
+/**
+ * @brief Print where the cycles went since the timing was set.
+ */
+void timing_report() {
+    unsigned int stalls = timing_counts.fetch + timing_counts.data + timing_counts.execute + timing_counts.branch;
+
+    printf("Timing: %u instructions in %u cycles, %u stall cycles (fetch %u, data %u, execute %u, branch %u)\n",
+        timing_counts.instructions, cpu_clock >> 1, stalls, timing_counts.fetch, timing_counts.data,
+        timing_counts.execute, timing_counts.branch);
+}
+
+/**
+ * @brief Menu entry: load a timing file, or go back to the default timing when one is loaded.
+ */
+void timing_menu() {
+    char filename[BUFFER_LEN];
+    int ch;
+
+    if (timing_active) {
+        timing_report();
+        timing_set(NULL);
+        printf("Timing from %s removed, back to one cycle per instruction.\n\n", timing_file);
+        return;
+    }
+
+    printf("Enter the timing file: ");
+    if (scanf("%255s", filename) != 1) {
+        printf("Invalid input.\n\n");
+    }
+    else if (timing_load(filename)) {
+        printf("Timing from %s loaded, the program runs through CPU() while it is on.\n\n", filename);
+    }
+    while ((ch = getchar()) != '\n' && ch != EOF);
+}
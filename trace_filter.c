@@ -0,0 +1,272 @@
+/**
+ * @file trace_filter.c
+ * @brief Filters that select which executed instructions appear in the diagnostic trace.
+ * @details Filters are combined (all enabled filters must pass). Every filter is reduced
+ *          to a precomputed bitmap or a single compare so that the per-cycle check stays
+ *          cheap compared to printing the trace line itself.
+ */
+
+#include "Emulator.h"
+
+int trace_enabled = TRUE;              // Master switch for the per-cycle diagnostic trace
+int trace_disasm = FALSE;              // Append the disassembled instruction to executed trace lines
+unsigned int trace_filter_flags = 0;   // Which of the TRACE_FILTER_* filters are active
+
+unsigned char trace_pc_map[TRACE_PC_MAP_LEN]; // One bit per instruction word address
+unsigned long long trace_type_mask = 0;        // One bit per enum instruct_table value
+
+static unsigned short trace_reg = 0;        // Register watched by the register filter
+static unsigned short trace_reg_value = 0;  // Value the watched register must be written with
+static unsigned int trace_sample_every = 1; // Keep only every Nth instruction that passed the other filters
+static unsigned int trace_sample_count = 0;
+
+/* Instruction types that write their dst register during E0 */
+static const unsigned long long writes_dst_in_e0 =
+    TRACE_TYPE_BIT(ADD_EXEC) | TRACE_TYPE_BIT(ADDC_EXEC) | TRACE_TYPE_BIT(SUB_EXEC) |
+    TRACE_TYPE_BIT(SUBC_EXEC) | TRACE_TYPE_BIT(DADD_EXEC) | TRACE_TYPE_BIT(XOR_EXEC) |
+    TRACE_TYPE_BIT(AND_EXEC) | TRACE_TYPE_BIT(OR_EXEC) | TRACE_TYPE_BIT(BIC_EXEC) |
+    TRACE_TYPE_BIT(BIS_EXEC) | TRACE_TYPE_BIT(MOV_EXEC) | TRACE_TYPE_BIT(SWAP_EXEC) |
+    TRACE_TYPE_BIT(SRA_EXEC) | TRACE_TYPE_BIT(RRC_EXEC) | TRACE_TYPE_BIT(SWPB_EXEC) |
+    TRACE_TYPE_BIT(SXT_EXEC) | TRACE_CLASS_MOVL;
+
+/**
+ * @brief Decide whether the instruction executed in this cycle should be traced.
+ * @param e1_dst Destination register written by an E1 (LD/LDR) in this cycle, or -1.
+ * @return TRUE if the trace line should be printed.
+ */
+int trace_filter_pass(int e1_dst) {
+    unsigned int flags = trace_filter_flags;
+
+    if (flags == 0) {
+        return TRUE;
+    }
+
+    if (skip_update_last_executed_address) { // NOP bubble, it belongs to no traced instruction
+        return FALSE;
+    }
+
+    if ((flags & TRACE_FILTER_PC) && !TRACE_PC_TEST(last_executed_address)) {
+        return FALSE;
+    }
+
+    if ((flags & TRACE_FILTER_TYPE) && !(trace_type_mask & TRACE_TYPE_BIT(global_inst_operands.instruction_type))) {
+        return FALSE;
+    }
+
+    if ((flags & TRACE_FILTER_TAKEN) && !d_bubble) { // d_bubble is only raised by a taken branch
+        return FALSE;
+    }
+
+    if (flags & TRACE_FILTER_REG) {
+        int written = (global_inst_operands.dst == trace_reg &&
+                       (writes_dst_in_e0 & TRACE_TYPE_BIT(global_inst_operands.instruction_type))) ||
+                      e1_dst == trace_reg;
+        if (!written || regfile[0][trace_reg] != trace_reg_value) {
+            return FALSE;
+        }
+    }
+
+    if (flags & TRACE_FILTER_SAMPLE) {
+        if (++trace_sample_count < trace_sample_every) {
+            return FALSE;
+        }
+        trace_sample_count = 0;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Mark the word addresses from start to end (inclusive) as traced.
+ */
+void trace_add_pc_range(unsigned short start, unsigned short end) {
+    unsigned int address;
+
+    for (address = start & ~1u; address <= end; address += PC_INCREMENT) {
+        trace_pc_map[address >> 4] |= (unsigned char)(1 << ((address >> 1) & 0x07));
+    }
+    trace_filter_flags |= TRACE_FILTER_PC;
+}
+
+/**
+ * @brief Remove every filter, tracing all instructions again.
+ */
+void trace_clear_filters() {
+    memset(trace_pc_map, 0, sizeof(trace_pc_map));
+    trace_type_mask = 0;
+    trace_sample_every = 1;
+    trace_sample_count = 0;
+    trace_filter_flags = 0;
+}
+
+/**
+ * @brief Print the filters currently applied to the trace.
+ */
+static void display_trace_filters() {
+    unsigned int address;
+    int in_range = FALSE;
+
+    printf("\nTracing is %s\n", trace_enabled ? "Enabled" : "Disabled");
+    if (trace_filter_flags == 0) {
+        printf("No filters active, every instruction is traced.\n\n");
+        return;
+    }
+
+    if (trace_filter_flags & TRACE_FILTER_PC) {
+        printf("PC ranges:");
+        for (address = 0; address <= MEM_SIZE; address += PC_INCREMENT) {
+            int set = address < MEM_SIZE && TRACE_PC_TEST(address);
+            if (set && !in_range) {
+                printf(" %04X", address);
+                in_range = TRUE;
+            }
+            else if (!set && in_range) {
+                printf("-%04X", address - PC_INCREMENT);
+                in_range = FALSE;
+            }
+        }
+        printf("\n");
+    }
+    if (trace_filter_flags & TRACE_FILTER_TYPE) {
+        printf("Instruction classes:%s%s%s%s%s\n",
+            (trace_type_mask & TRACE_CLASS_BRANCH) ? " Branches" : "",
+            (trace_type_mask & TRACE_CLASS_MEMORY) ? " LD/ST/LDR/STR" : "",
+            (trace_type_mask & TRACE_CLASS_ALU) ? " ALU" : "",
+            (trace_type_mask & TRACE_CLASS_MOVL) ? " MOVL-MOVH" : "",
+            (trace_type_mask & TRACE_CLASS_CC) ? " SETCC/CLRCC" : "");
+    }
+    if (trace_filter_flags & TRACE_FILTER_TAKEN) {
+        printf("Only taken branches\n");
+    }
+    if (trace_filter_flags & TRACE_FILTER_REG) {
+        printf("R%d written with %04X\n", trace_reg, trace_reg_value);
+    }
+    if (trace_filter_flags & TRACE_FILTER_SAMPLE) {
+        printf("Every %u instruction(s)\n", trace_sample_every);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Interactive submenu to configure the trace filters.
+ */
+void trace_filter_menu() {
+    int ch;
+    char user_choice;
+    unsigned short start, end, value;
+    unsigned int every;
+    int reg;
+
+    while (1) {
+        printf("\n===== Trace Filters =====\n");
+        printf("Press and enter E -> to Enable/Disable tracing (currently %s)\n", trace_enabled ? "Enabled" : "Disabled");
+        printf("Press and enter D -> to Toggle the disassembly column (currently %s)\n", trace_disasm ? "Enabled" : "Disabled");
+        printf("Press and enter A -> to Add a PC address range\n");
+        printf("Press and enter C -> to Select instruction classes\n");
+        printf("Press and enter T -> to Toggle taken branches only\n");
+        printf("Press and enter R -> to Trace only when a register is written with a value\n");
+        printf("Press and enter N -> to Sample every Nth instruction\n");
+        printf("Press and enter S -> to Show active filters\n");
+        printf("Press and enter X -> to Clear all filters\n");
+        printf("Press and enter B -> to Go back\n");
+        printf("Enter option here ==> ");
+        (void)scanf(" %c", &user_choice);
+        while ((ch = getchar()) != '\n' && ch != EOF);
+
+        switch (user_choice) {
+        case 'E':
+        case 'e':
+            trace_enabled = !trace_enabled;
+            printf("Tracing is now %s.\n", trace_enabled ? "Enabled" : "Disabled");
+            break;
+        case 'D':
+        case 'd':
+            trace_disasm = !trace_disasm;
+            printf("Disassembly column is now %s.\n", trace_disasm ? "Enabled" : "Disabled");
+            break;
+        case 'A':
+        case 'a':
+            printf("Enter start and end address in this format (start end: 1000 2000): ");
+            if (scanf("%4hx %4hx", &start, &end) != 2 || end < start) {
+                printf("Invalid address range.\n");
+            }
+            else {
+                trace_add_pc_range(start, end);
+                printf("Tracing PC range %04X-%04X.\n", start, end);
+            }
+            while ((ch = getchar()) != '\n' && ch != EOF);
+            break;
+        case 'C':
+        case 'c':
+            printf("Enter classes to trace (B = Branches, M = LD/ST/LDR/STR, A = ALU, L = MOVL-MOVH, C = SETCC/CLRCC): ");
+            trace_type_mask = 0;
+            while ((ch = getchar()) != '\n' && ch != EOF) {
+                switch (ch) {
+                case 'B': case 'b': trace_type_mask |= TRACE_CLASS_BRANCH; break;
+                case 'M': case 'm': trace_type_mask |= TRACE_CLASS_MEMORY; break;
+                case 'A': case 'a': trace_type_mask |= TRACE_CLASS_ALU; break;
+                case 'L': case 'l': trace_type_mask |= TRACE_CLASS_MOVL; break;
+                case 'C': case 'c': trace_type_mask |= TRACE_CLASS_CC; break;
+                default: break;
+                }
+            }
+            if (trace_type_mask) {
+                trace_filter_flags |= TRACE_FILTER_TYPE;
+            }
+            else {
+                trace_filter_flags &= ~TRACE_FILTER_TYPE;
+            }
+            break;
+        case 'T':
+        case 't':
+            trace_filter_flags ^= TRACE_FILTER_TAKEN;
+            printf("Taken branches only is now %s.\n", (trace_filter_flags & TRACE_FILTER_TAKEN) ? "Enabled" : "Disabled");
+            break;
+        case 'R':
+        case 'r':
+            printf("Enter register number and value in this format (reg value: 3 00FF): ");
+            if (scanf("%d %4hx", &reg, &value) != 2 || reg < 0 || reg >= NUM_REG_OR_CONS) {
+                printf("Invalid register or value.\n");
+            }
+            else {
+                trace_reg = (unsigned short)reg;
+                trace_reg_value = value;
+                trace_filter_flags |= TRACE_FILTER_REG;
+            }
+            while ((ch = getchar()) != '\n' && ch != EOF);
+            break;
+        case 'N':
+        case 'n':
+            printf("Enter N (1 traces every instruction): ");
+            if (scanf("%u", &every) != 1 || every == 0) {
+                printf("Invalid sampling interval.\n");
+            }
+            else {
+                trace_sample_every = every;
+                trace_sample_count = 0;
+                if (every > 1) {
+                    trace_filter_flags |= TRACE_FILTER_SAMPLE;
+                }
+                else {
+                    trace_filter_flags &= ~TRACE_FILTER_SAMPLE;
+                }
+            }
+            while ((ch = getchar()) != '\n' && ch != EOF);
+            break;
+        case 'S':
+        case 's':
+            display_trace_filters();
+            break;
+        case 'X':
+        case 'x':
+            trace_clear_filters();
+            printf("All trace filters cleared.\n");
+            break;
+        case 'B':
+        case 'b':
+            return;
+        default:
+            printf("Invalid option. Try again.\n");
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef XM23_H
+#define XM23_H
+
+/**
+ * @file xm23.h
+ * @brief Public C API of libxm23, for harnesses and language bindings that run the emulator in-process.
+ * @details Nothing here depends on the emulator's internal headers. Every function takes the
+ *          machine it acts on; a machine belongs to the thread that created it, and several
+ *          machines may be created on one thread. Device events posted with the internal
+ *          scheduler belong to the thread rather than to a machine. Functions returning int
+ *          return nonzero on success.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define XM23_API __attribute__((visibility("default")))
+#else
+#define XM23_API
+#endif
+
+#define XM23_API_VERSION 2
+
+typedef struct xm23_machine xm23_machine;
+
+enum xm23_memory { XM23_INSTRUCTION_MEMORY, XM23_DATA_MEMORY };
+
+// Why xm23_run() returned
+enum xm23_stop {
+    XM23_STOP_CYCLES,      // The requested number of clock cycles elapsed
+    XM23_STOP_BREAKPOINT,  // The instruction at the breakpoint executed
+    XM23_STOP_HALTED,      // The program stopped by itself (idle loop or sleep with nothing pending, or a device)
+    XM23_STOP_INTERRUPTED, // ^C
+    XM23_STOP_ERROR        // The run could not be started
+};
+
+typedef struct {
+    unsigned int cycles;         // Clock cycles since the machine was created
+    unsigned int runs;           // Calls to xm23_run()
+    unsigned int breakpoint_hits;
+    unsigned short last_address; // Address of the last instruction executed, 0xFFFF before the first
+} xm23_counters;
+
+XM23_API int xm23_api_version(void);
+
+XM23_API xm23_machine* xm23_create(void);
+XM23_API void xm23_destroy(xm23_machine* machine);
+
+XM23_API int xm23_load_file(xm23_machine* machine, const char* filename);
+XM23_API int xm23_load_buffer(xm23_machine* machine, const char* records, size_t length);
+
+XM23_API int xm23_reset(xm23_machine* machine); // Back to the state after the last load, copying only written pages
+XM23_API enum xm23_stop xm23_run(xm23_machine* machine, unsigned int cycles); // 0 cycles runs without a limit
+
+XM23_API unsigned short xm23_get_register(xm23_machine* machine, int reg); // R0-R7, R7 is the PC
+XM23_API void xm23_set_register(xm23_machine* machine, int reg, unsigned short value);
+XM23_API unsigned short xm23_get_psw(xm23_machine* machine);
+XM23_API void xm23_set_psw(xm23_machine* machine, unsigned short value);
+
+// Return the number of bytes copied, which stops at the end of the 64 KB memory
+XM23_API size_t xm23_read_memory(xm23_machine* machine, enum xm23_memory memory, unsigned short address,
+                                 void* buffer, size_t length);
+XM23_API size_t xm23_write_memory(xm23_machine* machine, enum xm23_memory memory, unsigned short address,
+                                  const void* buffer, size_t length);
+
+XM23_API void xm23_set_breakpoint(xm23_machine* machine, unsigned short address);
+XM23_API void xm23_clear_breakpoint(xm23_machine* machine);
+
+XM23_API void xm23_get_counters(xm23_machine* machine, xm23_counters* counters);
+XM23_API void xm23_set_trace(int enabled); // Diagnostic trace of debug builds, for every machine
+
+// Serve run requests from in_fd, each in a forked copy of machine; see fork_server.c for the line format
+XM23_API int xm23_fork_server(xm23_machine* machine, int in_fd, int out_fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XM23_H
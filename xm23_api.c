@@ -0,0 +1,223 @@
+/**
+ * @file xm23_api.c
+ * @brief The public C API declared in xm23.h.
+ * @details The emulator keeps its machine in the per-thread globals. A machine handle holds a
+ *          MachineState, and the handle last used on a thread is resident in that thread's
+ *          globals. Using another machine swaps them through state_capture()/state_restore(),
+ *          so a harness driving one machine never pays for a copy, and one alternating
+ *          between several pays one swap per switch.
+ */
+
+#include "Emulator.h"
+#include "xm23.h"
+
+struct xm23_machine {
+    MachineState state;           // Valid while the machine is not resident
+    MachineState image;           // Reset image, the machine as its program was loaded
+    unsigned short breakpoint_address;
+    int breakpoint_set;
+    int limit_reached;            // Set by the event xm23_run() posts at its cycle limit
+    unsigned int runs;
+    unsigned int breakpoint_hits;
+};
+
+static XM_CORE xm23_machine* resident = NULL; // Machine held in this thread's globals
+
+/**
+ * @brief Make machine the one in this thread's globals.
+ */
+static void xm23_select(xm23_machine* machine) {
+    if (resident == machine) {
+        return;
+    }
+    if (resident != NULL) {
+        state_capture(&resident->state);
+        resident->breakpoint_address = breakpoint_address;
+        resident->breakpoint_set = breakpoint_set;
+    }
+    state_restore(&machine->state);
+    reset_image = &machine->image;
+    breakpoint_address = machine->breakpoint_address;
+    breakpoint_set = machine->breakpoint_set;
+    resident = machine;
+}
+
+int xm23_api_version(void) {
+    return XM23_API_VERSION;
+}
+
+/**
+ * @brief Create a machine in its power-on state: memories and registers cleared, nothing loaded.
+ * @return NULL if out of memory.
+ */
+xm23_machine* xm23_create(void) {
+    xm23_machine* machine = calloc(1, sizeof(*machine));
+
+    if (machine == NULL) {
+        return NULL;
+    }
+    machine->state.last_executed_address = INVALID;
+    machine->image.last_executed_address = INVALID;
+    machine->breakpoint_address = INVALID;
+    machine->breakpoint_set = FALSE;
+    return machine;
+}
+
+void xm23_destroy(xm23_machine* machine) {
+    if (resident == machine) {
+        resident = NULL; // The globals keep its state until another machine is selected
+        reset_image = NULL;
+    }
+    free(machine);
+}
+
+int xm23_load_file(xm23_machine* machine, const char* filename) {
+    xm23_select(machine);
+    if (!load_xme_file(filename)) {
+        return FALSE;
+    }
+    reset_image_update();
+    return TRUE;
+}
+
+/**
+ * @brief Load S-records held in memory, in the same format as a .xme file.
+ */
+int xm23_load_buffer(xm23_machine* machine, const char* records, size_t length) {
+    xm23_select(machine);
+    if (!load_xme_buffer(records, length)) {
+        return FALSE;
+    }
+    reset_image_update();
+    return TRUE;
+}
+
+/**
+ * @brief Put the machine back as its program was loaded, copying only the pages written since.
+ * @details Memories, registers, PSW, clock and pipeline return to the state after the last
+ *          load. Breakpoints, counters and events posted to the scheduler are kept.
+ */
+int xm23_reset(xm23_machine* machine) {
+    xm23_select(machine);
+    return reset_to_image() >= 0;
+}
+
+/**
+ * @brief Scheduled by xm23_run() at its cycle limit.
+ */
+static void xm23_limit_reached(void* context, unsigned int when) {
+    (void)when;
+    ((xm23_machine*)context)->limit_reached = TRUE;
+    program_running = FALSE;
+}
+
+/**
+ * @brief Run until the cycle limit, the breakpoint, the program stopping, or ^C.
+ * @details The limit is an ordinary scheduled event, so idle loops are skipped up to it
+ *          exactly as they are up to a -t limit.
+ */
+enum xm23_stop xm23_run(xm23_machine* machine, unsigned int cycles) {
+    int limit_event = -1;
+    int interrupted;
+
+    xm23_select(machine);
+    machine->runs++;
+    machine->limit_reached = FALSE;
+    if (cycles) {
+        limit_event = sched_post(cpu_clock + cycles, xm23_limit_reached, machine);
+        if (limit_event < 0) {
+            return XM23_STOP_ERROR;
+        }
+    }
+
+    program_running = TRUE;
+    interrupted = run_xm_continuous();
+    if (limit_event >= 0 && !machine->limit_reached) {
+        sched_cancel(limit_event);
+    }
+
+    if (interrupted) {
+        return XM23_STOP_INTERRUPTED;
+    }
+    if (machine->limit_reached) {
+        return XM23_STOP_CYCLES;
+    }
+    if (breakpoint_set && last_executed_address == breakpoint_address) {
+        machine->breakpoint_hits++;
+        return XM23_STOP_BREAKPOINT;
+    }
+    return XM23_STOP_HALTED;
+}
+
+unsigned short xm23_get_register(xm23_machine* machine, int reg) {
+    xm23_select(machine);
+    return (reg >= 0 && reg < NUM_REG_OR_CONS) ? regfile[0][reg] : 0;
+}
+
+void xm23_set_register(xm23_machine* machine, int reg, unsigned short value) {
+    xm23_select(machine);
+    if (reg >= 0 && reg < NUM_REG_OR_CONS) {
+        regfile[0][reg] = value;
+    }
+}
+
+unsigned short xm23_get_psw(xm23_machine* machine) {
+    unsigned short value;
+
+    xm23_select(machine);
+    memcpy(&value, &psw, sizeof(value));
+    return value;
+}
+
+void xm23_set_psw(xm23_machine* machine, unsigned short value) {
+    xm23_select(machine);
+    memcpy(&psw, &value, sizeof(value));
+}
+
+/**
+ * @brief Bytes of a transfer at address that fit before the end of memory.
+ */
+static size_t xm23_clamp(unsigned short address, size_t length) {
+    return length < (size_t)(BTMEMSIZE - address) ? length : (size_t)(BTMEMSIZE - address);
+}
+
+size_t xm23_read_memory(xm23_machine* machine, enum xm23_memory memory, unsigned short address,
+                        void* buffer, size_t length) {
+    xm23_select(machine);
+    length = xm23_clamp(address, length);
+    memcpy(buffer, memory == XM23_DATA_MEMORY ? &dmemory.btmem[address] : &imemory.btmem[address], length);
+    return length;
+}
+
+size_t xm23_write_memory(xm23_machine* machine, enum xm23_memory memory, unsigned short address,
+                         const void* buffer, size_t length) {
+    xm23_select(machine);
+    length = xm23_clamp(address, length);
+    memcpy(memory == XM23_DATA_MEMORY ? &dmemory.btmem[address] : &imemory.btmem[address], buffer, length);
+    dirty_mark_range(memory == XM23_DATA_MEMORY ? data_mem : instruction_mem, address, (unsigned int)length);
+    return length;
+}
+
+void xm23_set_breakpoint(xm23_machine* machine, unsigned short address) {
+    xm23_select(machine);
+    breakpoint_address = address;
+    breakpoint_set = TRUE;
+}
+
+void xm23_clear_breakpoint(xm23_machine* machine) {
+    xm23_select(machine);
+    breakpoint_address = INVALID;
+    breakpoint_set = FALSE;
+}
+
+void xm23_get_counters(xm23_machine* machine, xm23_counters* counters) {
+    xm23_select(machine);
+    counters->cycles = cpu_clock;
+    counters->runs = machine->runs;
+    counters->breakpoint_hits = machine->breakpoint_hits;
+    counters->last_address = last_executed_address;
+}
+
+void xm23_set_trace(int enabled) {
+    trace_enabled = enabled ? TRUE : FALSE;
+}